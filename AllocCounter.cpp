@@ -0,0 +1,37 @@
+#include "AllocCounter.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+using namespace std;
+
+static atomic<uint64_t> allocationCount(0);
+static atomic<uint64_t> allocatedBytes(0);
+
+// Returns the number of calls to operator new (and new[]) so far
+uint64_t getAllocationCount() {
+  return allocationCount.load(memory_order_relaxed);
+}
+
+// Returns the total number of bytes requested from operator new so far
+uint64_t getAllocatedBytes() {
+  return allocatedBytes.load(memory_order_relaxed);
+}
+
+// Counts an allocation of size bytes and performs it with malloc
+static void *countedAllocate(size_t size) {
+  allocationCount.fetch_add(1, memory_order_relaxed);
+  allocatedBytes.fetch_add(size, memory_order_relaxed);
+
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+    throw bad_alloc();
+  return p;
+}
+
+// The replacement global allocation functions.  The nothrow and sized
+// forms provided by the standard library forward to these.
+void *operator new(size_t size)          { return countedAllocate(size); }
+void *operator new[](size_t size)        { return countedAllocate(size); }
+void operator delete(void *p) noexcept   { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
@@ -0,0 +1,19 @@
+#ifndef __ALLOCCOUNTER_H__
+#define __ALLOCCOUNTER_H__
+
+#include <stdint.h>
+
+/* Linking AllocCounter.o into a program replaces the global operator new and
+ * operator delete with versions that count every allocation and the bytes
+ * requested.  The counts are process-wide and safe to read from any thread.
+ * It is only linked into Bench, where it backs the allocation budget check;
+ * Binary uses the standard allocator.
+ */
+
+// Returns the number of calls to operator new (and new[]) so far
+uint64_t getAllocationCount();
+
+// Returns the total number of bytes requested from operator new so far
+uint64_t getAllocatedBytes();
+
+#endif
@@ -0,0 +1,218 @@
+#include "Assembler.h"
+#include <charconv>
+
+// Returns true for the characters that may separate items on a line
+static bool isBlankChar(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Returns true for the characters of a register name after the '$'
+static bool isNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+// Removes blanks from the start of text
+static void skipBlanks(string_view& text) {
+  size_t n = 0;
+  while (n < text.length() && isBlankChar(text[n]))
+    n++;
+  text.remove_prefix(n);
+}
+
+// Creates an assembler holding no words, for assembling lines one at a
+// time with assembleLine()
+Assembler::Assembler() {
+  myFormatCorrect = true;
+}
+
+// Assembles every line of the named file ("-" for stdin).  Blank lines
+// and lines holding only a comment ("# ...") are skipped.  If any line is
+// not a supported instruction, isFormatCorrect() is false and no words
+// are kept.
+Assembler::Assembler(string filename) {
+  myFormatCorrect = true;
+
+  MappedFile in(filename == "-" ? string("/dev/stdin") : filename);
+  if (!in.isOpen()) {
+    myFormatCorrect = false;
+    return;
+  }
+
+  string_view line;
+  uint32_t word;
+  while (in.getNextLine(line)) {
+    if (isBlank(line))
+      continue;
+    if (!assembleLine(line, word)) {
+      myFormatCorrect = false;
+      myWords.clear();
+      return;
+    }
+    myWords.push_back(word);
+  }
+}
+
+// This function assembles a single line of MIPS assembly into word.
+// Returns false if the line is not a supported instruction with valid
+// operands.
+bool Assembler::assembleLine(string_view line, uint32_t& word) {
+  skipEncoding(line);
+  skipBlanks(line);
+
+  // The mnemonic runs up to the first blank
+  size_t length = 0;
+  while (length < line.length() && !isBlankChar(line[length]))
+    length++;
+  Opcode opcode = opcodes.getOpcode(line.substr(0, length));
+  if (opcode == UNDEFINED)
+    return false;
+  line.remove_prefix(length);
+  skipBlanks(line);
+
+  // The operands, in the order isaSpec gives them, separated by commas
+  const OpcodeSpec& spec = opcodes.getSpec(opcode);
+  word = spec.fixedBits();
+  for (int n = 0; n < maxOperands && spec.operands[n] != OPERAND_NONE; n++) {
+    if (n > 0 && !parseSeparator(line, ','))
+      return false;
+    if (!parseOperand(line, spec.operands[n], word))
+      return false;
+  }
+
+  // Only a comment may follow
+  return line.empty() || line[0] == '#';
+}
+
+// This function returns true if line holds nothing but blanks or a comment
+bool Assembler::isBlank(string_view line) {
+  skipBlanks(line);
+  return line.empty() || line[0] == '#';
+}
+
+// This function removes a leading encoding column, as Binary prints it,
+// from line
+void Assembler::skipEncoding(string_view& line) {
+  if (line.length() <= (size_t)encodedInstLength || line[encodedInstLength] != '\t')
+    return;
+
+  uint32_t word;
+  if (packer.pack(line.data(), word))
+    line.remove_prefix(encodedInstLength + 1);
+}
+
+// These functions parse one item at the start of text, consuming it and
+// any blanks after it.  They return false if text does not start with
+// the item.
+bool Assembler::parseSeparator(string_view& text, char separator) {
+  if (text.empty() || text[0] != separator)
+    return false;
+  text.remove_prefix(1);
+  skipBlanks(text);
+  return true;
+}
+
+bool Assembler::parseRegister(string_view& text, int& reg) {
+  if (text.empty() || text[0] != '$')
+    return false;
+
+  size_t length = 1;
+  while (length < text.length() && isNameChar(text[length]))
+    length++;
+  reg = RegisterTable::getNum(text.substr(0, length));
+  if (reg == NumRegisters)
+    return false;
+
+  text.remove_prefix(length);
+  skipBlanks(text);
+  return true;
+}
+
+// Numbers are decimal, or hexadecimal with a "0x" prefix, and may be negative
+bool Assembler::parseNumber(string_view& text, int64_t& value) {
+  bool negative = !text.empty() && text[0] == '-';
+  const char *start = text.data() + (negative ? 1 : 0);
+  const char *end = text.data() + text.length();
+  int base = 10;
+  if (end - start > 2 && start[0] == '0' && (start[1] == 'x' || start[1] == 'X')) {
+    start += 2;
+    base = 16;
+  }
+
+  uint32_t magnitude;
+  from_chars_result result = from_chars(start, end, magnitude, base);
+  if (result.ec != errc())
+    return false;
+
+  value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+  text.remove_prefix(result.ptr - text.data());
+  skipBlanks(text);
+  return true;
+}
+
+// This function parses one operand of the given kind from text and puts
+// its value in the fields of word.  Returns false if the operand is
+// missing or out of range.
+bool Assembler::parseOperand(string_view& text, OperandKind kind, uint32_t& word) {
+  int reg;
+  int64_t value;
+
+  switch (kind) {
+    case OPERAND_RS:
+    case OPERAND_RT:
+    case OPERAND_RD:
+      if (!parseRegister(text, reg))
+        return false;
+      word |= (uint32_t)reg << (kind == OPERAND_RS ? rsShift : kind == OPERAND_RT ? rtShift : rdShift);
+      return true;
+
+    case OPERAND_SHAMT:
+      if (!parseNumber(text, value) || value < 0 || value > (int64_t)registerMask)
+        return false;
+      word |= (uint32_t)value << shamtShift;
+      return true;
+
+    case OPERAND_IMM:
+      if (!parseNumber(text, value) || value < INT16_MIN || value > INT16_MAX)
+        return false;
+      word |= (uint32_t)value & immediateMask;
+      return true;
+
+    case OPERAND_UIMM:
+      if (!parseNumber(text, value) || value < 0 || value > (int64_t)immediateMask)
+        return false;
+      word |= (uint32_t)value;
+      return true;
+
+    // A byte offset, printed as the 32 bit value of 4 times the word offset
+    case OPERAND_BRANCH: {
+      if (!parseNumber(text, value) || value < INT32_MIN || value > UINT32_MAX)
+        return false;
+      int32_t offset = (int32_t)(uint32_t)value;
+      if (offset % 4 != 0 || offset / 4 < INT16_MIN || offset / 4 > INT16_MAX)
+        return false;
+      word |= (uint32_t)(offset / 4) & immediateMask;
+      return true;
+    }
+
+    // A byte address within the 256MB region a jump can reach
+    case OPERAND_TARGET:
+      if (!parseNumber(text, value) || value < 0 || value % 4 != 0 ||
+          value / 4 > (int64_t)addressMask)
+        return false;
+      word |= (uint32_t)(value / 4);
+      return true;
+
+    // "imm(rs)"
+    case OPERAND_MEMORY:
+      if (!parseNumber(text, value) || value < INT16_MIN || value > INT16_MAX)
+        return false;
+      if (!parseSeparator(text, '(') || !parseRegister(text, reg) || !parseSeparator(text, ')'))
+        return false;
+      word |= ((uint32_t)value & immediateMask) | ((uint32_t)reg << rsShift);
+      return true;
+
+    case OPERAND_NONE:
+      break;
+  }
+  return true;
+}
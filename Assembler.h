@@ -0,0 +1,82 @@
+#ifndef __ASSEMBLER_H__
+#define __ASSEMBLER_H__
+
+#include "OpcodeTable.h"
+#include "RegisterTable.h"
+#include "MappedFile.h"
+#include "LinePacker.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class turns MIPS assembly text back into 32 bit instruction words,
+ * the reverse of BinaryParser.  It reads the text Binary prints, either with
+ * the leading encoding column ("00000000100010000001100000100000\tadd ...")
+ * or without it, and registers may be written by number ("$8") or by ABI
+ * name ("$t0").  Mnemonics and register names are found with the compile
+ * time perfect hashes of IsaSpec.h and RegisterTable.h, and operands are
+ * parsed in place, so assembling a line allocates nothing.
+ *
+ * Branch and jump operands are written the way Binary prints them: the word
+ * offset or address times 4, in hexadecimal ("0x400000").  Plain decimal
+ * numbers are accepted for them too.
+ */
+class Assembler {
+
+ public:
+
+  // Creates an assembler holding no words, for assembling lines one at a
+  // time with assembleLine()
+  Assembler();
+
+  // Assembles every line of the named file ("-" for stdin).  Blank lines
+  // and lines holding only a comment ("# ...") are skipped.  If any line is
+  // not a supported instruction, isFormatCorrect() is false and no words
+  // are kept.
+  Assembler(string filename);
+
+  // Returns true if every line of the file was assembled
+  bool isFormatCorrect()               { return myFormatCorrect; };
+
+  // Returns the assembled words, in file order
+  const vector<uint32_t>& getWords()   { return myWords; };
+
+  // This function assembles a single line of MIPS assembly into word.
+  // Returns false if the line is not a supported instruction with valid
+  // operands.
+  bool assembleLine(string_view line, uint32_t& word);
+
+ private:
+
+  vector<uint32_t> myWords;
+  bool myFormatCorrect;
+  OpcodeTable opcodes;
+  LinePacker packer;                       // recognises the encoding column
+
+  const static int encodedInstLength = 32; // The length of an encoded MIPS instruction
+
+  // This function returns true if line holds nothing but blanks or a comment
+  static bool isBlank(string_view line);
+
+  // This function removes a leading encoding column, as Binary prints it,
+  // from line
+  void skipEncoding(string_view& line);
+
+  // These functions parse one item at the start of text, consuming it and
+  // any blanks after it.  They return false if text does not start with
+  // the item.
+  static bool parseSeparator(string_view& text, char separator);
+  static bool parseRegister(string_view& text, int& reg);
+  static bool parseNumber(string_view& text, int64_t& value);
+
+  // This function parses one operand of the given kind from text and puts
+  // its value in the fields of word.  Returns false if the operand is
+  // missing or out of range.
+  static bool parseOperand(string_view& text, OperandKind kind, uint32_t& word);
+
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "AssemblyCache.h"
+#include <string.h>
+
+// Creates an empty cache with room for capacity words, rounded up to
+// a power of two (at least 2)
+AssemblyCache::AssemblyCache(int capacity) {
+  int bits = 1;
+  while ((1 << bits) < capacity && bits < 24)
+    bits++;
+
+  myCapacity = 1 << bits;
+  myShift = 32 - bits;
+  myHits = myMisses = 0;
+}
+
+// If the text for word is cached, sets text to a view of it and returns
+// true.  The view stays valid until word's slot is next replaced.
+bool AssemblyCache::lookup(uint32_t word, string_view& text) {
+  if (myEntries.empty()) {
+    myMisses++;
+    return false;
+  }
+
+  Entry& e = slotFor(word);
+  if (e.valid && e.word == word) {
+    myHits++;
+    text = string_view(e.text, e.length);
+    return true;
+  }
+  myMisses++;
+  return false;
+}
+
+// Caches text as the assembly of word and returns a view of the cached
+// copy.  Text longer than maxTextLength is returned uncached.
+string_view AssemblyCache::insert(uint32_t word, string_view text) {
+  if (text.length() > maxTextLength)
+    return text;
+
+  // The table is only allocated once something is cached, so that a
+  // parser which formats nothing does not pay for it
+  if (myEntries.empty()) {
+    Entry empty;
+    empty.word = 0;
+    empty.length = 0;
+    empty.valid = false;
+    myEntries.assign(myCapacity, empty);
+  }
+
+  Entry& e = slotFor(word);
+  e.word = word;
+  e.length = text.length();
+  e.valid = true;
+  memcpy(e.text, text.data(), text.length());
+  return string_view(e.text, e.length);
+}
+
+// Adds the hit and miss counts of other to this cache's, so that caches
+// used by separate threads can be reported together.  Entries are not copied.
+void AssemblyCache::addCounts(const AssemblyCache& other) {
+  myHits += other.myHits;
+  myMisses += other.myMisses;
+}
@@ -0,0 +1,74 @@
+#ifndef __ASSEMBLYCACHE_H__
+#define __ASSEMBLYCACHE_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class remembers the assembly text of recently formatted instruction
+ * words, so that words which repeat (loop bodies, nop padding) are only
+ * formatted once.  It is a direct-mapped table: each word hashes to one
+ * slot, and a new word simply replaces whatever was in its slot.  Hit and
+ * miss counts are kept so the capacity can be tuned.  A cache must not be
+ * shared between threads.
+ */
+class AssemblyCache {
+
+ public:
+
+  // Creates an empty cache with room for capacity words, rounded up to
+  // a power of two (at least 2)
+  AssemblyCache(int capacity = defaultCapacity);
+
+  // If the text for word is cached, sets text to a view of it and returns
+  // true.  The view stays valid until word's slot is next replaced.
+  bool lookup(uint32_t word, string_view& text);
+
+  // Caches text as the assembly of word and returns a view of the cached
+  // copy.  Text longer than maxTextLength is returned uncached.
+  string_view insert(uint32_t word, string_view text);
+
+  // Returns the number of lookups that found their word
+  uint64_t getHits()     { return myHits; };
+
+  // Returns the number of lookups that did not find their word
+  uint64_t getMisses()   { return myMisses; };
+
+  // Adds the hit and miss counts of other to this cache's, so that caches
+  // used by separate threads can be reported together.  Entries are not copied.
+  void addCounts(const AssemblyCache& other);
+
+  // Returns the number of words the cache can hold
+  int getCapacity()      { return myCapacity; };
+
+  // Number of words held by a default cache
+  const static int defaultCapacity = 4096;
+
+  // Longest assembly text that can be cached
+  const static int maxTextLength = 47;
+
+ private:
+
+  // One slot of the table
+  struct Entry {
+    uint32_t word;
+    uint8_t length;
+    bool valid;
+    char text[maxTextLength];
+  };
+
+  vector<Entry> myEntries;  // empty until the first insert
+  int myCapacity;
+  int myShift;           // 32 - log2(capacity), used by slotFor
+  uint64_t myHits;
+  uint64_t myMisses;
+
+  // Returns the slot that word maps to
+  Entry& slotFor(uint32_t word) { return myEntries[(word * 0x9e3779b1u) >> myShift]; };
+
+};
+
+#endif
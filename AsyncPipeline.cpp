@@ -0,0 +1,606 @@
+#include "AsyncPipeline.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/* A minimal io_uring: one submission and one completion ring, driven with
+ * the raw system calls.  Only the calls this file needs are provided. */
+class AsyncPipeline::IoRing {
+
+ public:
+
+  // Creates a ring for entries requests and checks that the kernel can
+  // read and write through it.  Check isOpen() for success.
+  IoRing(unsigned entries);
+
+  // Unmaps the rings and closes the ring's descriptor
+  ~IoRing();
+
+  bool isOpen() { return myFd >= 0; };
+
+  // Prepares a read (write false) or write of length bytes at buffer from
+  // or to fd at offset (-1 for the current file position), to be passed
+  // to the kernel by the next submit()
+  void prepare(bool write, int fd, char *buffer, size_t length, uint64_t offset, uint64_t tag);
+
+  // Passes the prepared requests to the kernel and waits until at least
+  // waitFor requests have completed.  Returns false if the kernel refused.
+  bool submit(unsigned waitFor);
+
+  // Takes the next completion off the ring, returning false if there is none
+  bool nextCompletion(uint64_t& tag, long& res);
+
+ private:
+
+  int myFd;
+  unsigned myPending;          // requests prepared but not yet submitted
+#ifdef __linux__
+  void *mySqRing;
+  size_t mySqRingSize;
+  void *myCqRing;
+  size_t myCqRingSize;
+  io_uring_sqe *mySqes;
+  size_t mySqesSize;
+  unsigned *mySqTail, *mySqMask, *mySqArray;
+  unsigned *myCqHead, *myCqTail, *myCqMask;
+  io_uring_cqe *myCqes;
+
+  // This function unmaps whatever has been mapped and closes the descriptor
+  void close();
+#endif
+
+};
+
+#ifdef __linux__
+
+// Creates a ring for entries requests and checks that the kernel can
+// read and write through it.  Check isOpen() for success.
+AsyncPipeline::IoRing::IoRing(unsigned entries) {
+  myPending = 0;
+  mySqRing = myCqRing = MAP_FAILED;
+  mySqes = (io_uring_sqe *)MAP_FAILED;
+
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  myFd = syscall(__NR_io_uring_setup, entries, &params);
+  if (myFd < 0)
+    return;
+
+  // The two rings share one mapping on kernels that allow it
+  mySqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  myCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single)
+    mySqRingSize = myCqRingSize = (mySqRingSize > myCqRingSize) ? mySqRingSize : myCqRingSize;
+
+  mySqRing = mmap(NULL, mySqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  myFd, IORING_OFF_SQ_RING);
+  if (mySqRing != MAP_FAILED && !single)
+    myCqRing = mmap(NULL, myCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    myFd, IORING_OFF_CQ_RING);
+  mySqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  mySqes = (io_uring_sqe *)mmap(NULL, mySqesSize, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, myFd, IORING_OFF_SQES);
+  void *cqRing = single ? mySqRing : myCqRing;
+  if (mySqRing == MAP_FAILED || cqRing == MAP_FAILED || mySqes == MAP_FAILED) {
+    close();
+    return;
+  }
+
+  char *sq = (char *)mySqRing, *cq = (char *)cqRing;
+  mySqTail = (unsigned *)(sq + params.sq_off.tail);
+  mySqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+  mySqArray = (unsigned *)(sq + params.sq_off.array);
+  myCqHead = (unsigned *)(cq + params.cq_off.head);
+  myCqTail = (unsigned *)(cq + params.cq_off.tail);
+  myCqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+  myCqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  // Reads and writes at offsets are only available from Linux 5.6
+  const int numOps = 256;
+  vector<char> probeBuffer(sizeof(io_uring_probe) + numOps * sizeof(io_uring_probe_op), 0);
+  io_uring_probe *probe = (io_uring_probe *)probeBuffer.data();
+  if (syscall(__NR_io_uring_register, myFd, IORING_REGISTER_PROBE, probe, numOps) < 0 ||
+      probe->last_op < IORING_OP_WRITE ||
+      !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) ||
+      !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+    close();
+}
+
+// Unmaps the rings and closes the ring's descriptor
+AsyncPipeline::IoRing::~IoRing() {
+  close();
+}
+
+// This function unmaps whatever has been mapped and closes the descriptor
+void AsyncPipeline::IoRing::close() {
+  if (mySqes != MAP_FAILED)
+    munmap(mySqes, mySqesSize);
+  if (myCqRing != MAP_FAILED)
+    munmap(myCqRing, myCqRingSize);
+  if (mySqRing != MAP_FAILED)
+    munmap(mySqRing, mySqRingSize);
+  mySqRing = myCqRing = MAP_FAILED;
+  mySqes = (io_uring_sqe *)MAP_FAILED;
+  if (myFd >= 0)
+    ::close(myFd);
+  myFd = -1;
+}
+
+// Prepares a read (write false) or write of length bytes at buffer from
+// or to fd at offset (-1 for the current file position), to be passed
+// to the kernel by the next submit()
+void AsyncPipeline::IoRing::prepare(bool write, int fd, char *buffer, size_t length,
+                                    uint64_t offset, uint64_t tag) {
+  // Only this thread moves the tail, so it can be read without ordering
+  unsigned tail = *mySqTail;
+  unsigned index = tail & *mySqMask;
+  io_uring_sqe *sqe = &mySqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buffer;
+  sqe->len = length;
+  sqe->off = offset;
+  sqe->user_data = tag;
+  mySqArray[index] = index;
+
+  // The kernel must see the entry before the new tail
+  __atomic_store_n(mySqTail, tail + 1, __ATOMIC_RELEASE);
+  myPending++;
+}
+
+// Passes the prepared requests to the kernel and waits until at least
+// waitFor requests have completed.  Returns false if the kernel refused.
+bool AsyncPipeline::IoRing::submit(unsigned waitFor) {
+  while (myPending > 0 || waitFor > 0) {
+    long submitted = syscall(__NR_io_uring_enter, myFd, myPending, waitFor,
+                             waitFor ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (submitted < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    myPending -= submitted;
+    waitFor = 0;
+  }
+  return true;
+}
+
+// Takes the next completion off the ring, returning false if there is none
+bool AsyncPipeline::IoRing::nextCompletion(uint64_t& tag, long& res) {
+  unsigned head = *myCqHead;
+  if (head == __atomic_load_n(myCqTail, __ATOMIC_ACQUIRE))
+    return false;
+
+  io_uring_cqe *cqe = &myCqes[head & *myCqMask];
+  tag = cqe->user_data;
+  res = cqe->res;
+  __atomic_store_n(myCqHead, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+#else
+
+// Without io_uring the ring never opens and the threads are used instead
+AsyncPipeline::IoRing::IoRing(unsigned entries)  { myFd = -1; myPending = 0; }
+AsyncPipeline::IoRing::~IoRing()                 { }
+void AsyncPipeline::IoRing::prepare(bool write, int fd, char *buffer, size_t length,
+                                    uint64_t offset, uint64_t tag) { }
+bool AsyncPipeline::IoRing::submit(unsigned waitFor)                      { return false; }
+bool AsyncPipeline::IoRing::nextCompletion(uint64_t& tag, long& res)      { return false; }
+
+#endif
+
+// Starts reading inFd, depth blocks of blockSize bytes ahead, for output
+// to outFd through depth buffers.  io_uring is used if method asks for it
+// and the kernel supports it; see getMethod().
+AsyncPipeline::AsyncPipeline(int inFd, int outFd, AsyncMethod method, size_t blockSize,
+                             int depth) {
+  myInFd = inFd;
+  myOutFd = outFd;
+  myBlockSize = blockSize;
+  myError = false;
+  myWriteFailed = false;
+  myInputDone = false;
+  myNextRead = 0;
+  myNextBlock = 0;
+  myHeldInput = -1;
+  myFillingOutput = -1;
+  myReadsInFlight = 0;
+  myWritesInFlight = 0;
+  myStopping = false;
+  if (depth < 2)
+    depth = 2;
+
+  // Only regular files have offsets that several requests can share
+  struct stat status;
+  off_t position;
+  mySeekableIn = fstat(inFd, &status) == 0 && S_ISREG(status.st_mode) &&
+                 (position = lseek(inFd, 0, SEEK_CUR)) >= 0;
+  myInSize = mySeekableIn ? status.st_size : 0;
+  myInOffset = mySeekableIn ? position : 0;
+
+  int flags = fcntl(outFd, F_GETFL);
+  mySeekableOut = fstat(outFd, &status) == 0 && S_ISREG(status.st_mode) &&
+                  flags >= 0 && !(flags & O_APPEND) &&
+                  (position = lseek(outFd, 0, SEEK_CUR)) >= 0;
+  myOutOffset = mySeekableOut ? position : 0;
+
+  myInputs.resize(depth);
+  myOutputs.resize(depth);
+  for (InputSlot& slot : myInputs) {
+    slot.data.resize(blockSize);
+    slot.state = SLOT_FREE;
+  }
+  for (OutputSlot& slot : myOutputs) {
+    slot.text.reset(new OutputWriter(-1, FLUSH_WHEN_FULL, blockSize + blockSize / 2));
+    slot.state = SLOT_FREE;
+  }
+
+  // Every slot can have a request in flight, with room to spare
+  myMethod = ASYNC_THREADS;
+  if (method == ASYNC_URING) {
+    myRing.reset(new IoRing(4 * depth));
+    if (myRing->isOpen())
+      myMethod = ASYNC_URING;
+    else
+      myRing.reset();
+  }
+  if (myMethod == ASYNC_THREADS) {
+    myReader = thread(&AsyncPipeline::readerLoop, this);
+    myWriter = thread(&AsyncPipeline::writerLoop, this);
+  }
+
+  lock_guard<mutex> guard(myLock);
+  startReads();
+  if (myRing)
+    myRing->submit(0);
+}
+
+// Waits for the queued writes and stops the I/O
+AsyncPipeline::~AsyncPipeline() {
+  finish();
+
+  // The kernel or the reader may still be filling blocks read ahead
+  {
+    unique_lock<mutex> lock(myLock);
+    myStopping = true;
+    while (myReadsInFlight > 0)
+      waitForProgress(lock);
+  }
+  myChanged.notify_all();
+  if (myReader.joinable())
+    myReader.join();
+  if (myWriter.joinable())
+    myWriter.join();
+}
+
+// Sets block to the next block of the input and returns true, or returns
+// false at the end of the input or after a read error (see hasError()).
+// The block stays valid until the next call.
+bool AsyncPipeline::nextBlock(string_view& block) {
+  unique_lock<mutex> lock(myLock);
+  if (myHeldInput >= 0) {
+    myInputs[myHeldInput].state = SLOT_FREE;
+    myHeldInput = -1;
+    startReads();
+    if (myRing)
+      myRing->submit(0);
+  }
+
+  while (true) {
+    if (myError)
+      return false;
+    for (size_t s = 0; s < myInputs.size(); s++) {
+      InputSlot& slot = myInputs[s];
+      if (slot.state != SLOT_READY || slot.block != myNextBlock)
+        continue;
+
+      // An empty block is the end of the input
+      if (slot.length == 0) {
+        slot.state = SLOT_FREE;
+        return false;
+      }
+      slot.state = SLOT_HELD;
+      myHeldInput = s;
+      myNextBlock++;
+      block = string_view(slot.data.data(), slot.length);
+      return true;
+    }
+    if (myNextBlock == myNextRead && myInputDone)
+      return false;
+    waitForProgress(lock);
+  }
+}
+
+// Returns an empty in-memory writer to format the next output into,
+// waiting for a buffer to be written if all of them are in use
+OutputWriter& AsyncPipeline::getOutput() {
+  unique_lock<mutex> lock(myLock);
+  while (true) {
+    for (size_t s = 0; s < myOutputs.size(); s++) {
+      if (myOutputs[s].state == SLOT_FREE) {
+        myOutputs[s].state = SLOT_HELD;
+        myOutputs[s].text->clear();
+        myFillingOutput = s;
+        return *myOutputs[s].text;
+      }
+    }
+    waitForProgress(lock);
+  }
+}
+
+// Queues what was written to the writer returned by getOutput() for
+// writing to outFd
+void AsyncPipeline::submitOutput() {
+  lock_guard<mutex> guard(myLock);
+  if (myFillingOutput < 0)
+    return;
+
+  OutputSlot& slot = myOutputs[myFillingOutput];
+  size_t size = slot.text->getContents().length();
+  if (size == 0)
+    slot.state = SLOT_FREE;
+  else {
+    slot.state = SLOT_QUEUED;
+    slot.written = 0;
+    slot.offset = myOutOffset;
+    if (mySeekableOut)
+      myOutOffset += size;
+    myWriteQueue.push_back(myFillingOutput);
+    startWrites();
+  }
+  myFillingOutput = -1;
+
+  // Start the writes now rather than when the caller next waits
+  if (myRing && !myRing->submit(0))
+    myError = true;
+}
+
+// Waits for every queued write.  Returns false if any read or write failed.
+bool AsyncPipeline::finish() {
+  unique_lock<mutex> lock(myLock);
+  while (!myWriteQueue.empty() || myWritesInFlight > 0)
+    waitForProgress(lock);
+
+  // The writes did not move the descriptor's offset, so leave it after them
+  if (mySeekableOut)
+    lseek(myOutFd, myOutOffset, SEEK_SET);
+  return !myError;
+}
+
+// Returns the name of a method ("io_uring" or "threads")
+string AsyncPipeline::getMethodName(AsyncMethod method) {
+  return method == ASYNC_URING ? "io_uring" : "threads";
+}
+
+// This function starts as many reads as may be in flight: one per free
+// slot for a regular file, and one at a time for anything else
+void AsyncPipeline::startReads() {
+  for (size_t s = 0; s < myInputs.size() && !myInputDone && !myError && !myStopping; s++) {
+    InputSlot& slot = myInputs[s];
+    if (slot.state != SLOT_FREE)
+      continue;
+    if (!mySeekableIn && myReadsInFlight > 0)
+      return;
+
+    slot.block = myNextRead++;
+    slot.length = 0;
+    slot.offset = myInOffset;
+    slot.wanted = myBlockSize;
+    if (mySeekableIn) {
+      uint64_t left = myInSize > myInOffset ? myInSize - myInOffset : 0;
+      slot.wanted = left < myBlockSize ? left : myBlockSize;
+      myInOffset += slot.wanted;
+      myInputDone = (myInOffset >= myInSize);
+    }
+    slot.state = SLOT_BUSY;
+    myReadsInFlight++;
+
+    // The last block of a regular file may be empty, marking the end
+    if (slot.wanted == 0)
+      readDone(s, 0);
+    else
+      issueRead(s);
+  }
+}
+
+// This function starts as many writes as may be in flight: every queued
+// slot for a regular file, and one at a time, in order, for anything else
+void AsyncPipeline::startWrites() {
+  while (!myWriteQueue.empty() && (mySeekableOut || myWritesInFlight == 0)) {
+    int s = myWriteQueue.front();
+    myWriteQueue.pop_front();
+    if (myWriteFailed) {
+      myOutputs[s].state = SLOT_FREE;
+      continue;
+    }
+    myOutputs[s].state = SLOT_BUSY;
+    myWritesInFlight++;
+    issueWrite(s);
+  }
+}
+
+// This function hands the rest of a slot's read to the ring or to the
+// reader thread
+void AsyncPipeline::issueRead(int s) {
+  InputSlot& slot = myInputs[s];
+  if (myRing)
+    myRing->prepare(false, myInFd, slot.data.data() + slot.length, slot.wanted - slot.length,
+                    mySeekableIn ? slot.offset + slot.length : (uint64_t)-1, 2 * s);
+  else {
+    myReadRequests.push_back(s);
+    myChanged.notify_all();
+  }
+}
+
+// This function hands the rest of a slot's write to the ring or to the
+// writer thread
+void AsyncPipeline::issueWrite(int s) {
+  OutputSlot& slot = myOutputs[s];
+  string_view text = slot.text->getContents();
+  if (myRing)
+    myRing->prepare(true, myOutFd, (char *)text.data() + slot.written, text.length() - slot.written,
+                    mySeekableOut ? slot.offset + slot.written : (uint64_t)-1, 2 * s + 1);
+  else {
+    myWriteRequests.push_back(s);
+    myChanged.notify_all();
+  }
+}
+
+// This function handles a completed read of res bytes (or -errno) into slot
+void AsyncPipeline::readDone(int s, long res) {
+  InputSlot& slot = myInputs[s];
+  if (res == -EINTR || res == -EAGAIN) {
+    issueRead(s);
+    return;
+  }
+
+  myReadsInFlight--;
+  if (res < 0) {
+    slot.state = SLOT_FREE;
+    myError = true;
+    myInputDone = true;
+    return;
+  }
+
+  slot.length += res;
+  if (res == 0 || !mySeekableIn) {
+    // The end of the input, or as much as a pipe had to give
+    if (res == 0)
+      myInputDone = true;
+    slot.state = SLOT_READY;
+    return;
+  }
+
+  // A short read of a regular file gets the rest of its block
+  if (slot.length < slot.wanted) {
+    myReadsInFlight++;
+    issueRead(s);
+    return;
+  }
+  slot.state = SLOT_READY;
+}
+
+// This function handles a completed write of res bytes (or -errno) from slot
+void AsyncPipeline::writeDone(int s, long res) {
+  OutputSlot& slot = myOutputs[s];
+  if (res == -EINTR || res == -EAGAIN) {
+    issueWrite(s);
+    return;
+  }
+
+  if (res <= 0) {
+    myError = true;
+    myWriteFailed = true;
+  }
+  else {
+    slot.written += res;
+    if (slot.written < slot.text->getContents().length()) {
+      issueWrite(s);
+      return;
+    }
+  }
+
+  slot.state = SLOT_FREE;
+  myWritesInFlight--;
+  startWrites();
+}
+
+// This function submits any prepared requests and waits for at least one
+// to complete, handling every completion.  lock holds myLock.
+void AsyncPipeline::waitForProgress(unique_lock<mutex>& lock) {
+  if (!myRing) {
+    myChanged.wait(lock);
+    return;
+  }
+
+  // Nothing in flight would never complete
+  if (myReadsInFlight == 0 && myWritesInFlight == 0) {
+    myError = true;
+    myInputDone = true;
+    myWriteQueue.clear();
+    return;
+  }
+  if (!myRing->submit(1)) {
+    myError = true;
+    return;
+  }
+
+  uint64_t tag;
+  long res;
+  while (myRing->nextCompletion(tag, res)) {
+    if (tag & 1)
+      writeDone(tag / 2, res);
+    else
+      readDone(tag / 2, res);
+  }
+  startReads();
+  myRing->submit(0);
+}
+
+// The reader thread of ASYNC_THREADS: performs the reads startReads() asks for
+void AsyncPipeline::readerLoop() {
+  unique_lock<mutex> lock(myLock);
+  while (true) {
+    while (myReadRequests.empty() && !myStopping)
+      myChanged.wait(lock);
+    if (myReadRequests.empty())
+      return;
+
+    int s = myReadRequests.front();
+    myReadRequests.pop_front();
+    InputSlot& slot = myInputs[s];
+    char *buffer = slot.data.data() + slot.length;
+    size_t length = slot.wanted - slot.length;
+    off_t offset = slot.offset + slot.length;
+
+    lock.unlock();
+    ssize_t res = mySeekableIn ? pread(myInFd, buffer, length, offset) : read(myInFd, buffer, length);
+    if (res < 0)
+      res = -errno;
+    lock.lock();
+
+    readDone(s, res);
+    startReads();
+    myChanged.notify_all();
+  }
+}
+
+// The writer thread of ASYNC_THREADS: performs the writes startWrites() asks for
+void AsyncPipeline::writerLoop() {
+  unique_lock<mutex> lock(myLock);
+  while (true) {
+    while (myWriteRequests.empty() && !myStopping)
+      myChanged.wait(lock);
+    if (myWriteRequests.empty())
+      return;
+
+    int s = myWriteRequests.front();
+    myWriteRequests.pop_front();
+    OutputSlot& slot = myOutputs[s];
+    string_view text = slot.text->getContents();
+    const char *buffer = text.data() + slot.written;
+    size_t length = text.length() - slot.written;
+    off_t offset = slot.offset + slot.written;
+
+    lock.unlock();
+    ssize_t res = mySeekableOut ? pwrite(myOutFd, buffer, length, offset)
+                                : write(myOutFd, buffer, length);
+    if (res < 0)
+      res = -errno;
+    lock.lock();
+
+    writeDone(s, res);
+    myChanged.notify_all();
+  }
+}
@@ -0,0 +1,175 @@
+#ifndef __ASYNCPIPELINE_H__
+#define __ASYNCPIPELINE_H__
+
+#include "OutputWriter.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// How an AsyncPipeline performs its reads and writes
+enum AsyncMethod {
+  ASYNC_URING,      // Linux io_uring, submitted and reaped by the caller's thread
+  ASYNC_THREADS     // a reader thread and a writer thread using read(2)/write(2)
+};
+
+/* This class keeps the input and output of a decoder moving while it
+ * works.  The input file is read in large blocks, with several blocks read
+ * ahead, and output is formatted into one of several buffers while the
+ * ones before it are being written, so reading, decoding and writing
+ * overlap and throughput approaches the slowest of the three rather than
+ * their sum.
+ *
+ * The I/O is done with io_uring when the kernel provides it, and by a
+ * reader and a writer thread otherwise.  Blocks are always handed out, and
+ * output always written, in order.  Regular files are read and written at
+ * explicit offsets with several requests in flight; pipes, terminals and
+ * files opened for appending get one request at a time, since the order of
+ * concurrent requests on them is not defined.
+ *
+ * The caller's loop is: nextBlock() to get input, getOutput() for a buffer
+ * to format into, submitOutput() to queue it, and finish() at the end.
+ */
+class AsyncPipeline {
+
+ public:
+
+  // Starts reading inFd, depth blocks of blockSize bytes ahead, for output
+  // to outFd through depth buffers.  io_uring is used if method asks for it
+  // and the kernel supports it; see getMethod().
+  AsyncPipeline(int inFd, int outFd, AsyncMethod method = ASYNC_URING,
+                size_t blockSize = defaultBlockSize, int depth = defaultDepth);
+
+  // Waits for the queued writes and stops the I/O
+  ~AsyncPipeline();
+
+  // Returns the method actually in use
+  AsyncMethod getMethod()  { return myMethod; };
+
+  // Sets block to the next block of the input and returns true, or returns
+  // false at the end of the input or after a read error (see hasError()).
+  // The block stays valid until the next call.
+  bool nextBlock(string_view& block);
+
+  // Returns an empty in-memory writer to format the next output into,
+  // waiting for a buffer to be written if all of them are in use
+  OutputWriter& getOutput();
+
+  // Queues what was written to the writer returned by getOutput() for
+  // writing to outFd
+  void submitOutput();
+
+  // Waits for every queued write.  Returns false if any read or write failed.
+  bool finish();
+
+  // Returns true if a read or write has failed
+  bool hasError()          { return myError; };
+
+  // Returns the name of a method ("io_uring" or "threads")
+  static string getMethodName(AsyncMethod method);
+
+  const static size_t defaultBlockSize = 1 << 20;
+  const static int defaultDepth = 4;
+
+ private:
+
+  class IoRing;
+
+  // The states of an input or output buffer
+  enum SlotState {
+    SLOT_FREE,        // not in use
+    SLOT_BUSY,        // being read into or written from
+    SLOT_READY,       // input read and waiting to be handed out
+    SLOT_HELD,        // input handed out, or output being formatted
+    SLOT_QUEUED       // output waiting for its turn to be written
+  };
+
+  struct InputSlot {
+    vector<char> data;
+    SlotState state;
+    uint64_t block;     // number of the block it holds
+    size_t length;      // bytes read so far
+    size_t wanted;      // bytes the block should hold
+    uint64_t offset;    // file offset of the block
+  };
+
+  struct OutputSlot {
+    unique_ptr<OutputWriter> text;
+    SlotState state;
+    size_t written;     // bytes written so far
+    uint64_t offset;    // file offset of the output, for a seekable outFd
+  };
+
+  int myInFd;
+  int myOutFd;
+  AsyncMethod myMethod;
+  size_t myBlockSize;
+  bool myError;
+  bool myWriteFailed;             // queued output is dropped once a write fails
+
+  bool mySeekableIn;              // reads can be issued at explicit offsets
+  bool mySeekableOut;             // writes can be issued at explicit offsets
+  uint64_t myInSize;              // size of a seekable input
+  uint64_t myInOffset;            // offset of the next block to read
+  uint64_t myOutOffset;           // offset of the next output to queue
+  bool myInputDone;               // no more blocks will be read
+
+  vector<InputSlot> myInputs;
+  vector<OutputSlot> myOutputs;
+  uint64_t myNextRead;            // number of the next block to read
+  uint64_t myNextBlock;           // number of the next block to hand out
+  int myHeldInput;                // slot handed out by nextBlock(), or -1
+  int myFillingOutput;            // slot handed out by getOutput(), or -1
+  deque<int> myWriteQueue;        // output slots in the order they must be written
+  int myReadsInFlight;
+  int myWritesInFlight;
+
+  unique_ptr<IoRing> myRing;      // for ASYNC_URING
+
+  thread myReader;                // for ASYNC_THREADS
+  thread myWriter;
+  deque<int> myReadRequests;      // slots for the reader thread to read into
+  deque<int> myWriteRequests;     // slots for the writer thread to write out
+  bool myStopping;
+
+  mutex myLock;                   // guards everything above after construction
+  condition_variable myChanged;   // signalled whenever a request completes
+
+  // These functions start as many reads and writes as may be in flight
+  void startReads();
+  void startWrites();
+
+  // These functions hand the rest of a slot's read or write to the ring or
+  // to the reader or writer thread
+  void issueRead(int slot);
+  void issueWrite(int slot);
+
+  // This function handles a completed read of res bytes (or -errno) into slot
+  void readDone(int slot, long res);
+
+  // This function handles a completed write of res bytes (or -errno) from slot
+  void writeDone(int slot, long res);
+
+  // This function submits any prepared requests and waits for at least one
+  // to complete, handling every completion.  lock holds myLock.
+  void waitForProgress(unique_lock<mutex>& lock);
+
+  // Bodies of the reader and writer threads of ASYNC_THREADS
+  void readerLoop();
+  void writerLoop();
+
+  // AsyncPipelines own buffers that the kernel may be using, so they cannot be copied
+  AsyncPipeline(const AsyncPipeline&);
+  AsyncPipeline& operator=(const AsyncPipeline&);
+
+};
+
+#endif
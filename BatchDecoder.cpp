@@ -0,0 +1,346 @@
+#include "BatchDecoder.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The decoded text of one chunk of a file, held until it can be written
+struct Chunk {
+  size_t start, end;              // byte range of the input
+  unique_ptr<OutputWriter> text;  // the assembly, until written out
+  size_t numLines;                // lines (or words) decoded
+  bool done;
+  bool failed;                    // stopped at a bad line
+  DecodeError error;              // the bad line, numbered within the chunk
+};
+
+// A file being decoded
+struct BatchDecoder::FileJob {
+  BatchResult *result;
+  unique_ptr<MappedFile> in;
+  vector<Chunk> chunks;
+  atomic<size_t> firstBadChunk;   // chunks after this one need not be decoded
+
+  mutex lock;                     // guards the members below
+  size_t nextChunk;               // first chunk not yet started
+  size_t nextToWrite;             // first chunk not yet written
+  size_t waitingTasks;            // tasks that stopped while too many chunks were unwritten
+  size_t linesWritten;            // lines in the chunks written so far
+  unique_ptr<OutputWriter> out;   // the output file
+  int fd;
+  bool failed;
+
+  FileJob() : result(NULL), firstBadChunk(SIZE_MAX), nextChunk(0), nextToWrite(0),
+              waitingTasks(0), linesWritten(0), fd(-1), failed(false) {};
+};
+
+// Creates a batch that writes its output under outputDir, reading the
+// inputs in format and decoding on numThreads threads
+BatchDecoder::BatchDecoder(string outputDir, InputFormat format, int numThreads) {
+  myOutputDir = outputDir;
+  myFormat = format;
+  myNumThreads = numThreads < 1 ? 1 : numThreads;
+  mySteals = 0;
+}
+
+// This function adds the files named by path to the batch: the file
+// itself, every file under path if it is a directory, or every path
+// listed one per line in the file if path starts with '@'.  A file is
+// written to outputDir under its own name, or under its path within the
+// directory it was found in, with ".asm" added.  Returns false, with the
+// reason on stderr, if path cannot be read or two inputs would share an
+// output file.
+bool BatchDecoder::addInputs(string path) {
+  if (!path.empty() && path[0] == '@') {
+    ifstream list(path.substr(1));
+    if (!list) {
+      cerr << "Cannot read file list " << path.substr(1) << endl;
+      return false;
+    }
+    string line;
+    while (getline(list, line))
+      if (!line.empty() && !addInputs(line))
+        return false;
+    return true;
+  }
+
+  error_code error;
+  if (!filesystem::is_directory(path, error))
+    return addFile(path, filesystem::path(path).filename().string());
+
+  // Directories are walked in sorted order, so the results are repeatable
+  vector<filesystem::path> files;
+  for (filesystem::recursive_directory_iterator entry(path, error), end;
+       !error && entry != end; entry.increment(error))
+    if (entry->is_regular_file())
+      files.push_back(entry->path());
+  if (error) {
+    cerr << "Cannot read directory " << path << ": " << error.message() << endl;
+    return false;
+  }
+
+  sort(files.begin(), files.end());
+  for (const filesystem::path& file : files)
+    if (!addFile(file.string(), filesystem::relative(file, path).string()))
+      return false;
+  return true;
+}
+
+// This function adds one input file, written to outputDir/name.asm
+bool BatchDecoder::addFile(string input, string name) {
+  BatchResult result;
+  result.input = input;
+  result.output = (filesystem::path(myOutputDir) / name).string() + ".asm";
+  if (!myOutputs.insert(result.output).second) {
+    cerr << "Two inputs would both be written to " << result.output << endl;
+    return false;
+  }
+
+  error_code error;
+  result.size = filesystem::file_size(input, error);
+  if (error)
+    result.size = 0;
+  result.correct = false;
+  result.readable = true;
+  result.writable = true;
+  result.error = DecodeError{ 0, 0, 0, BAD_LENGTH };
+  result.numInstructions = 0;
+  result.numChunks = 0;
+  result.maxBufferedChunks = 0;
+  myResults.push_back(result);
+  return true;
+}
+
+// This function decodes every file added and returns the number that
+// were not correct
+size_t BatchDecoder::run() {
+  while ((int)myParsers.size() < myNumThreads)
+    myParsers.push_back(unique_ptr<BinaryParser>(new BinaryParser()));
+
+  vector<unique_ptr<FileJob> > jobs;
+  for (BatchResult& result : myResults) {
+    jobs.push_back(unique_ptr<FileJob>(new FileJob()));
+    jobs.back()->result = &result;
+  }
+
+  // Largest first, so the longest files are not left until the end
+  vector<FileJob *> order;
+  for (unique_ptr<FileJob>& job : jobs)
+    order.push_back(job.get());
+  stable_sort(order.begin(), order.end(), [](FileJob *a, FileJob *b) {
+    return a->result->size > b->result->size;
+  });
+
+  {
+    WorkStealingPool pool(myNumThreads);
+    for (FileJob *job : order)
+      pool.submit([this, &pool, job](int worker) { startFile(pool, *job, worker); });
+    pool.wait();
+    mySteals = pool.getSteals();
+  }
+
+  size_t failed = 0;
+  for (BatchResult& result : myResults)
+    if (!result.correct)
+      failed++;
+  return failed;
+}
+
+// This function maps a file, opens its output and splits it into chunks,
+// queueing tasks to decode them and decoding alongside them
+void BatchDecoder::startFile(WorkStealingPool& pool, FileJob& job, int worker) {
+  BatchResult& result = *job.result;
+
+  job.in.reset(new MappedFile(result.input));
+  if (!job.in->isOpen()) {
+    result.readable = false;
+    job.in.reset();
+    return;
+  }
+
+  // Raw input is a sequence of whole 4 byte words
+  size_t size = job.in->getSize();
+  if (myFormat != TEXT_INPUT && size % 4 != 0) {
+    result.error = DecodeError{ size / 4 + 1, size - size % 4, 0, BAD_LENGTH };
+    job.in.reset();
+    return;
+  }
+
+  error_code error;
+  filesystem::create_directories(filesystem::path(result.output).parent_path(), error);
+  job.fd = open(result.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (job.fd < 0) {
+    result.writable = false;
+    job.in.reset();
+    return;
+  }
+  job.out.reset(new OutputWriter(job.fd));
+
+  // Chunk boundaries fall on line starts (or word starts for raw input)
+  size_t numChunks = size / splitSize + 1;
+  size_t start = 0;
+  for (size_t c = 1; c <= numChunks; c++) {
+    size_t end = size;
+    if (c < numChunks) {
+      end = size / numChunks * c;
+      end = (myFormat == TEXT_INPUT) ? job.in->findLineStart(end) : end - end % 4;
+    }
+    if (end > start || c == numChunks) {
+      Chunk chunk;
+      chunk.start = start;
+      chunk.end = end;
+      chunk.numLines = 0;
+      chunk.done = false;
+      chunk.failed = false;
+      chunk.error = DecodeError{ 0, 0, 0, BAD_LENGTH };
+      job.chunks.push_back(move(chunk));
+    }
+    start = end;
+  }
+  result.numChunks = job.chunks.size();
+
+  // The tasks claim chunks in order rather than being handed one each, so
+  // a thief never starts on the end of the file while its start is unread
+  size_t numTasks = min(job.chunks.size(), (size_t)myNumThreads);
+  for (size_t t = 1; t < numTasks; t++)
+    pool.submit([this, &pool, &job](int worker) { decodeChunks(pool, job, worker); });
+  decodeChunks(pool, job, worker);
+}
+
+// This function decodes the chunks of a file on worker, lowest first,
+// until none is left or too many are waiting to be written
+void BatchDecoder::decodeChunks(WorkStealingPool& pool, FileJob& job, int worker) {
+  size_t c;
+  while (claimChunk(pool, job, c))
+    decodeChunk(job, c, worker);
+}
+
+// This function sets c to the lowest chunk of a file not yet started and
+// returns true, or returns false if there is none or too many chunks are
+// waiting to be written
+bool BatchDecoder::claimChunk(WorkStealingPool& pool, FileJob& job, size_t& c) {
+  lock_guard<mutex> guard(job.lock);
+  size_t limit = min(job.chunks.size(), job.nextToWrite + 2 * myNumThreads);
+  if (job.nextChunk >= limit) {
+    // The task decoding chunk nextToWrite claims again once it is written
+    if (job.nextChunk < job.chunks.size())
+      job.waitingTasks++;
+    return false;
+  }
+
+  c = job.nextChunk++;
+  job.result->maxBufferedChunks = max(job.result->maxBufferedChunks,
+                                      job.nextChunk - job.nextToWrite);
+
+  // Writing has made room, so bring back the tasks that stopped
+  for (size_t room = limit - job.nextChunk; job.waitingTasks > 0 && room > 0; room--) {
+    job.waitingTasks--;
+    pool.submit([this, &pool, &job](int worker) { decodeChunks(pool, job, worker); });
+  }
+  return true;
+}
+
+// This function decodes chunk c of a file on worker
+void BatchDecoder::decodeChunk(FileJob& job, size_t c, int worker) {
+  BinaryParser& parser = *myParsers[worker];
+  MappedFile& in = *job.in;
+  Chunk& chunk = job.chunks[c];
+  // About 1.6 bytes of output per byte of text input, 50 per raw word
+  size_t expansion = (myFormat == TEXT_INPUT) ? 2 : 16;
+  chunk.text.reset(new OutputWriter(-1, FLUSH_WHEN_FULL, expansion * (chunk.end - chunk.start)));
+  Instruction i;
+
+  if (myFormat != TEXT_INPUT) {
+    for (size_t pos = chunk.start; pos < chunk.end; pos += 4) {
+      if (job.firstBadChunk.load(memory_order_relaxed) < c)
+        break;
+      uint32_t word = BinaryParser::unpackRawWord(in.getData() + pos, myFormat);
+      if (!parser.decodeWord(word, i)) {
+        chunk.failed = true;
+        chunk.error = DecodeError{ chunk.numLines, pos, 0, BinaryParser::diagnoseWord(word) };
+        break;
+      }
+      chunk.text->appendEncodedLine(i.getWord(), parser.getAssembly(i));
+      chunk.numLines++;
+    }
+  }
+  else {
+    string_view line;
+    size_t pos = chunk.start;
+    uint32_t word;
+    while (in.getNextLine(pos, chunk.end, line)) {
+      if (job.firstBadChunk.load(memory_order_relaxed) < c)
+        break;
+      if (!parser.checkInstSyntax(line, word) || !parser.decodeWord(word, i)) {
+        chunk.failed = true;
+        chunk.error = BinaryParser::diagnoseLine(line);
+        chunk.error.line = chunk.numLines;
+        chunk.error.offset = line.data() - in.getData();
+        break;
+      }
+      chunk.text->appendEncodedLine(i.getWord(), parser.getAssembly(i));
+      chunk.numLines++;
+    }
+  }
+
+  // Later chunks of the file need not be decoded
+  if (chunk.failed) {
+    size_t first = job.firstBadChunk.load();
+    while (c < first && !job.firstBadChunk.compare_exchange_weak(first, c))
+      ;
+  }
+
+  finishChunk(job, c);
+}
+
+// This function marks chunk c of a file done, writes out every chunk now
+// complete in order, and finishes the file after its last chunk
+void BatchDecoder::finishChunk(FileJob& job, size_t c) {
+  lock_guard<mutex> guard(job.lock);
+  job.chunks[c].done = true;
+
+  while (job.nextToWrite < job.chunks.size() && job.chunks[job.nextToWrite].done) {
+    Chunk& chunk = job.chunks[job.nextToWrite];
+    if (!job.failed && chunk.failed) {
+      job.result->error = chunk.error;
+      job.result->error.line += job.linesWritten + 1;
+      failFile(job);
+    }
+    if (!job.failed) {
+      job.out->append(chunk.text->getContents());
+      job.linesWritten += chunk.numLines;
+    }
+    chunk.text.reset();
+    job.nextToWrite++;
+  }
+
+  if (job.nextToWrite < job.chunks.size())
+    return;
+
+  // The last chunk is done: finish the file and release its input
+  if (!job.failed) {
+    if (job.out->flush()) {
+      job.result->correct = true;
+      job.result->numInstructions = job.linesWritten;
+    }
+    else {
+      job.result->writable = false;
+      failFile(job);
+    }
+  }
+  job.out.reset();
+  if (job.fd >= 0)
+    close(job.fd);
+  job.fd = -1;
+  job.in.reset();
+}
+
+// This function records a file as failed, removing its output
+void BatchDecoder::failFile(FileJob& job) {
+  job.failed = true;
+  job.out->clear();
+  unlink(job.result->output.c_str());
+}
@@ -0,0 +1,114 @@
+#ifndef __BATCHDECODER_H__
+#define __BATCHDECODER_H__
+
+#include "BinaryParser.h"
+#include "OutputWriter.h"
+#include "WorkStealingPool.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <set>
+#include <stdint.h>
+
+using namespace std;
+
+// The outcome of decoding one file of a batch
+struct BatchResult {
+  string input;               // path of the encoded file
+  string output;              // path the assembly was written to
+  uint64_t size;              // bytes of input
+  bool correct;               // true if every line decoded and the output was written
+  bool readable;              // false if the input could not be read
+  bool writable;              // false if the output could not be written
+  DecodeError error;          // the first bad line, if the file was readable
+                              // but not correct
+  uint64_t numInstructions;   // instructions written (0 unless correct)
+  size_t numChunks;           // pieces the file was split into
+  size_t maxBufferedChunks;   // most chunks decoding or waiting to be written at once
+};
+
+/* This class decodes many files concurrently, writing the assembly of each
+ * to a file of its own under an output directory, as Binary would print
+ * it.  Files are scheduled largest first on a WorkStealingPool, and a file
+ * larger than splitSize is split at line boundaries into chunks that are
+ * decoded as separate tasks, so idle workers can steal pieces of a big file
+ * instead of waiting behind it.  Workers always take the lowest chunk not
+ * yet started, and the chunks of a file are written out in order as soon
+ * as all the chunks before them are done.  At most twice as many chunks as
+ * there are threads are held decoded but unwritten per file; a worker that
+ * finds that many waiting moves on and is called back when one is written.
+ *
+ * As with Binary, nothing is kept from a file with a bad line: its output
+ * file is removed, and its result records the first bad line.
+ */
+class BatchDecoder {
+
+ public:
+
+  // Creates a batch that writes its output under outputDir, reading the
+  // inputs in format and decoding on numThreads threads
+  BatchDecoder(string outputDir, InputFormat format = TEXT_INPUT, int numThreads = 1);
+
+  // This function adds the files named by path to the batch: the file
+  // itself, every file under path if it is a directory, or every path
+  // listed one per line in the file if path starts with '@'.  A file is
+  // written to outputDir under its own name, or under its path within the
+  // directory it was found in, with ".asm" added.  Returns false, with the
+  // reason on stderr, if path cannot be read or two inputs would share an
+  // output file.
+  bool addInputs(string path);
+
+  // This function decodes every file added and returns the number that
+  // were not correct
+  size_t run();
+
+  // Returns the outcome of every file, in the order they were added
+  const vector<BatchResult>& getResults()  { return myResults; };
+
+  // Returns the number of tasks workers stole from each other during run()
+  uint64_t getSteals()                     { return mySteals; };
+
+  // Files larger than this many bytes are split into chunks of about this size
+  const static size_t splitSize = 4 << 20;
+
+ private:
+
+  struct FileJob;
+
+  string myOutputDir;
+  InputFormat myFormat;
+  int myNumThreads;
+  vector<BatchResult> myResults;
+  set<string> myOutputs;                        // output paths in use
+  vector<unique_ptr<BinaryParser> > myParsers;  // one per worker, for its assembly cache
+  uint64_t mySteals;
+
+  // This function adds one input file, written to outputDir/name.asm
+  bool addFile(string input, string name);
+
+  // This function maps a file, opens its output and splits it into chunks,
+  // queueing tasks to decode them and decoding alongside them
+  void startFile(WorkStealingPool& pool, FileJob& job, int worker);
+
+  // This function decodes the chunks of a file on worker, lowest first,
+  // until none is left or too many are waiting to be written
+  void decodeChunks(WorkStealingPool& pool, FileJob& job, int worker);
+
+  // This function sets c to the lowest chunk of a file not yet started and
+  // returns true, or returns false if there is none or too many chunks are
+  // waiting to be written
+  bool claimChunk(WorkStealingPool& pool, FileJob& job, size_t& c);
+
+  // This function decodes chunk c of a file on worker
+  void decodeChunk(FileJob& job, size_t c, int worker);
+
+  // This function marks chunk c of a file done, writes out every chunk now
+  // complete in order, and finishes the file after its last chunk
+  void finishChunk(FileJob& job, size_t c);
+
+  // This function records a file as failed, removing its output
+  void failFile(FileJob& job);
+
+};
+
+#endif
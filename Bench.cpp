@@ -0,0 +1,300 @@
+#include "AllocCounter.h"
+#include "Assembler.h"
+#include "BinaryParser.h"
+#include "CorpusGenerator.h"
+#include "OutputWriter.h"
+#include "PerfCounters.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* This file benchmarks the decoder on a deterministic synthetic corpus.  The
+ * corpus is generated, written to a temporary file in the text format, and
+ * then run through each phase of the pipeline separately:
+ *   read      map the file and split it into lines
+ *   validate  check each line and pack it into a word
+ *   decode    decode each word into an Instruction
+ *   format    format each Instruction as an output line (as Binary does)
+ *   assemble  assemble the formatted lines back into words (as Binary -a
+ *             does), checking that they match the corpus
+ *   write     write the formatted output to /dev/null
+ * For each phase the best time over several repetitions is reported as
+ * ns/instruction and millions of instructions/second.  With --perf each
+ * phase is also wrapped in hardware performance counters (cycles,
+ * instructions, branch misses, L1d and LLC misses), reported per decoded
+ * instruction averaged over all repetitions.
+ *
+ * Finally the steady-state path (decodeWord, getAssembly and an OutputWriter
+ * that is already set up) is run once more over the corpus with a warmed-up
+ * parser while the allocator is counted (see AllocCounter.h), and the
+ * allocations and bytes per instruction are reported.  With --alloc-budget N
+ * the program exits with status 1 if there are more than N allocations per
+ * instruction, so a regression can fail the build (make alloc-gate).
+ *
+ * Usage: Bench [count] [--seed S] [--mix add=3,lb=1,...] [--kernel scalar|sse2|avx2]
+ *              [--repeat R] [--perf] [--alloc-budget N]
+ */
+
+typedef chrono::steady_clock Clock;
+
+// Returns the seconds elapsed since start
+static double secondsSince(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Prints one row of the results table
+static void report(const char *phase, double seconds, size_t count) {
+  cout << left << setw(10) << phase << right << fixed
+       << setw(10) << setprecision(2) << seconds * 1e9 / count << " ns/inst"
+       << setw(10) << setprecision(1) << count / seconds / 1e6 << " Minst/s" << endl;
+}
+
+// Prints how Bench is run and exits with status 1
+static void usage() {
+  cerr << "Usage: Bench [count] [--seed S] [--mix add=3,lb=1,...] [--kernel scalar|sse2|avx2]" << endl
+       << "             [--repeat R] [--perf] [--alloc-budget N]" << endl;
+  exit(1);
+}
+
+// Returns the value following the flag at argv[arg], advancing arg past it.
+// Exits with the usage if the flag is the last argument.
+static const char *flagValue(int argc, char *argv[], int& arg) {
+  if (arg + 1 >= argc) {
+    cerr << argv[arg] << " needs a value." << endl;
+    usage();
+  }
+  return argv[++arg];
+}
+
+// Parses text as a whole decimal number.  Exits with the usage if any of
+// it is not a digit.
+static uint64_t parseNumber(const char *text) {
+  char *end;
+  uint64_t value = strtoull(text, &end, 10);
+  if (text[0] < '0' || text[0] > '9' || *end != '\0') {
+    cerr << "Not a number: " << text << endl;
+    usage();
+  }
+  return value;
+}
+
+int main(int argc, char *argv[]) {
+  size_t count = 1000000;
+  uint64_t seed = 1;
+  string mix, kernel;
+  int repeat = 5;
+  bool usePerf = false;
+  double allocBudget = -1;
+
+  for (int arg = 1; arg < argc; arg++) {
+    if (strcmp(argv[arg], "--seed") == 0)
+      seed = parseNumber(flagValue(argc, argv, arg));
+    else if (strcmp(argv[arg], "--mix") == 0)
+      mix = flagValue(argc, argv, arg);
+    else if (strcmp(argv[arg], "--kernel") == 0)
+      kernel = flagValue(argc, argv, arg);
+    else if (strcmp(argv[arg], "--repeat") == 0)
+      repeat = parseNumber(flagValue(argc, argv, arg));
+    else if (strcmp(argv[arg], "--perf") == 0)
+      usePerf = true;
+    else if (strcmp(argv[arg], "--alloc-budget") == 0) {
+      const char *value = flagValue(argc, argv, arg);
+      char *end;
+      allocBudget = strtod(value, &end);
+      if (end == value || *end != '\0' || allocBudget < 0) {
+        cerr << "Allocation budget must be a number of at least 0." << endl;
+        usage();
+      }
+    }
+    else if (argv[arg][0] == '-') {
+      cerr << "Unknown option " << argv[arg] << endl;
+      usage();
+    }
+    else
+      count = parseNumber(argv[arg]);
+  }
+  if (count == 0 || repeat < 1) {
+    cerr << "Instruction count and repeat count must be positive." << endl;
+    exit(1);
+  }
+
+  // Generate the corpus and write it to a temporary file
+  CorpusGenerator generator(seed);
+  if (!mix.empty() && !generator.setMix(mix)) {
+    cerr << "Opcode mix must be a list such as add=3,lb=1,j=1." << endl;
+    exit(1);
+  }
+
+  char corpusName[] = "/tmp/mipsbenchXXXXXX";
+  int corpusFd = mkstemp(corpusName);
+  if (corpusFd < 0) {
+    cerr << "Could not create a temporary corpus file." << endl;
+    exit(1);
+  }
+  {
+    OutputWriter corpus(corpusFd);
+    for (size_t n = 0; n < count; n++) {
+      corpus.appendBinary(generator.nextWord());
+      corpus.endLine();
+    }
+  }
+  close(corpusFd);
+
+  BinaryParser parser;
+  LinePacker packer;
+  if (!kernel.empty() && !packer.selectKernel(kernel)) {
+    cerr << "Kernel " << kernel << " is not available on this CPU." << endl;
+    exit(1);
+  }
+
+  vector<string_view> lines;
+  vector<uint32_t> words;
+  vector<Instruction> instructions;
+  int devNull = open("/dev/null", O_WRONLY);
+
+  vector<uint32_t> assembled;
+  Assembler assembler;
+
+  // One set of hardware counters per phase, if asked for
+  const int numPhases = 6;
+  const char *phases[numPhases] = { "read", "validate", "decode", "format", "assemble", "write" };
+  unique_ptr<PerfCounters[]> perf(usePerf ? new PerfCounters[numPhases] : NULL);
+
+  double best[numPhases];
+  for (int p = 0; p < numPhases; p++)
+    best[p] = 1e30;
+
+  for (int r = 0; r < repeat; r++) {
+    double seconds;
+
+    // read
+    lines.clear();
+    lines.reserve(count);
+    if (perf) perf[0].start();
+    Clock::time_point start = Clock::now();
+    MappedFile in(corpusName);
+    string_view line;
+    while (in.getNextLine(line))
+      lines.push_back(line);
+    seconds = secondsSince(start);
+    if (perf) perf[0].stop();
+    best[0] = min(best[0], seconds);
+
+    // validate
+    words.assign(lines.size(), 0);
+    if (perf) perf[1].start();
+    start = Clock::now();
+    for (size_t n = 0; n < lines.size(); n++)
+      if (lines[n].length() != 32 || !packer.pack(lines[n].data(), words[n])) {
+        cerr << "Corpus line " << n + 1 << " is invalid." << endl;
+        exit(1);
+      }
+    seconds = secondsSince(start);
+    if (perf) perf[1].stop();
+    best[1] = min(best[1], seconds);
+
+    // decode
+    instructions.assign(words.size(), Instruction());
+    if (perf) perf[2].start();
+    start = Clock::now();
+    for (size_t n = 0; n < words.size(); n++)
+      parser.decodeWord(words[n], instructions[n]);
+    seconds = secondsSince(start);
+    if (perf) perf[2].stop();
+    best[2] = min(best[2], seconds);
+
+    // format
+    BinaryParser formatter;
+    OutputWriter formatted(-1, FLUSH_WHEN_FULL, count * 64);
+    if (perf) perf[3].start();
+    start = Clock::now();
+    for (size_t n = 0; n < instructions.size(); n++)
+      formatted.appendEncodedLine(instructions[n].getWord(), formatter.getAssembly(instructions[n]));
+    seconds = secondsSince(start);
+    if (perf) perf[3].stop();
+    best[3] = min(best[3], seconds);
+
+    // assemble
+    string_view text = formatted.getContents();
+    assembled.assign(count, 0);
+    if (perf) perf[4].start();
+    start = Clock::now();
+    for (size_t n = 0; n < count; n++) {
+      size_t newline = text.find('\n');
+      if (!assembler.assembleLine(text.substr(0, newline), assembled[n])) {
+        cerr << "Formatted line " << n + 1 << " does not assemble." << endl;
+        exit(1);
+      }
+      text.remove_prefix(newline + 1);
+    }
+    seconds = secondsSince(start);
+    if (perf) perf[4].stop();
+    best[4] = min(best[4], seconds);
+    if (assembled != words) {
+      cerr << "Assembled words do not match the corpus." << endl;
+      exit(1);
+    }
+
+    // write
+    if (perf) perf[5].start();
+    start = Clock::now();
+    {
+      OutputWriter out(devNull);
+      out.append(formatted.getContents());
+    }
+    seconds = secondsSince(start);
+    if (perf) perf[5].stop();
+    best[5] = min(best[5], seconds);
+  }
+
+  // Steady state: warm up a parser on the start of the corpus, then count
+  // the allocations made decoding and formatting all of it
+  BinaryParser steady;
+  OutputWriter sink(devNull);
+  Instruction instruction;
+  for (size_t n = 0; n < min(count, (size_t) 4096); n++) {
+    steady.decodeWord(words[n], instruction);
+    steady.getAssembly(instruction);
+  }
+  uint64_t allocationsBefore = getAllocationCount();
+  uint64_t bytesBefore = getAllocatedBytes();
+  for (size_t n = 0; n < words.size(); n++) {
+    steady.decodeWord(words[n], instruction);
+    sink.appendEncodedLine(instruction.getWord(), steady.getAssembly(instruction));
+  }
+  sink.flush();
+  double allocations = double(getAllocationCount() - allocationsBefore) / count;
+  double bytes = double(getAllocatedBytes() - bytesBefore) / count;
+
+  close(devNull);
+  unlink(corpusName);
+
+  cout << count << " instructions, seed " << seed << ", " << packer.getKernelName()
+       << " validation, best of " << repeat << endl;
+  double total = 0;
+  for (int p = 0; p < numPhases; p++) {
+    report(phases[p], best[p], count);
+    total += best[p];
+  }
+  report("total", total, count);
+
+  if (perf) {
+    cout << endl << "Hardware counters per instruction (all repetitions):" << endl;
+    for (int p = 0; p < numPhases; p++)
+      perf[p].report(cout, phases[p], count * repeat);
+  }
+
+  cout << endl << "Steady-state allocations: " << setprecision(4)
+       << allocations << " allocs/inst, " << bytes << " bytes/inst" << endl;
+  if (allocBudget >= 0 && allocations > allocBudget) {
+    cerr << "Allocation budget of " << allocBudget
+         << " allocs/inst exceeded." << endl;
+    exit(1);
+  }
+}
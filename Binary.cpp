@@ -1,5 +1,23 @@
+#include "Assembler.h"
+#include "AsyncPipeline.h"
+#include "BatchDecoder.h"
 #include "BinaryParser.h"
+#include "DecodeServer.h"
+#include "OutputWriter.h"
+#include "PerfCounters.h"
+#include "RecordWriter.h"
+#include "Simulator.h"
+#include "UsageHistogram.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -7,31 +25,758 @@ using namespace std;
  * If the file is correct syntactically, each instruction in the file
  * will be translated from its 32 bit MIPS binary encoding and printed
  * to stdout, one per line.
+ *
+ * Usage: Binary [-s|--stream] [-r|--raw big|little] [-j N] [--cache-stats]
+ *              [--flush line|full] [--stats[=json]] [--perf] [--all-errors]
+ *              [--format text|jsonl|csv|columnar] <file>
+ *        Binary -a|--assemble [-r|--raw big|little] [--flush line|full] <file>
+ *        Binary --run [--max-steps N] [-r|--raw big|little] [-j N] <file>
+ *        Binary --serve [--socket path] [--max-payload N] [-j N]
+ *        Binary --batch -o|--output-dir dir [-r|--raw big|little] [-j N] <input>...
+ *        Binary --histogram[=json] [-s] [-r|--raw big|little] [-j N] <file>...
+ *        Binary --async[=uring|threads] [-r|--raw big|little] <file>
+ *   A file name of "-" reads the encodings from stdin.
+ *   With -r the input is a raw image of 4 byte words in the given byte
+ *   order instead of lines of '0'/'1' characters.
+ *   With -j the file is decoded and formatted on N threads.  It has no
+ *   effect on stdin or in streaming mode.
+ *   --cache-stats reports the assembly cache's hits and misses on stderr.
+ *   With -j each thread's share of the output has a cache of its own, and
+ *   the totals of all of them are reported.
+ *   Output is buffered and written in large blocks.  --flush line writes
+ *   every line as soon as it is formatted (the default when stdout is a
+ *   terminal); --flush full only writes when the buffer fills.
+ *   --stats prints the time spent in each phase, instruction counts per
+ *   type and opcode, bytes read and written, and peak memory use to stderr
+ *   when the program exits; --stats=json prints them as a JSON object.
+ *   It is only available when built with -DDECODE_STATS.
+ *   --perf counts hardware events (cycles, instructions, branch misses,
+ *   L1d and LLC misses) separately for reading and decoding the input and
+ *   for formatting and writing the output, and prints them per instruction
+ *   on stderr.  In streaming mode decoding happens during output, so it is
+ *   counted with the output.  Reports why if the kernel denies access.
+ *   In streaming mode instructions are decoded in fixed-size batches and
+ *   printed as they are decoded, so output starts immediately and memory use
+ *   does not grow with the input.  If a bad line is found, the instructions
+ *   before it have already been printed.
+ *   Normally nothing is printed if any line is bad.  With --all-errors the
+ *   whole input is validated instead: every bad line is reported on stderr
+ *   with its line number, byte offset and reason, the good lines are still
+ *   decoded and printed, and the exit status is 1 if there were bad lines.
+ *   It cannot be combined with streaming.
+ *   --format selects the layout of the output: text (the default), JSON
+ *   Lines or CSV records holding each instruction's fields, or a binary
+ *   file of one array per field (see RecordWriter.h).  No assembly text is
+ *   formatted for the last three.  The columnar format cannot be streamed,
+ *   and no other format can be used with --serve, --batch, --histogram,
+ *   -a, --run or --async.
+ *   With -a the file holds assembly text instead (as printed by Binary, with
+ *   or without the encoding column), and each instruction's encoding is
+ *   printed, one per line, or written as raw words with -r.  Nothing is
+ *   printed if any line is not a supported instruction.
+ *   With --run the decoded program is executed by the simulator (see
+ *   Simulator.h) from its first instruction, loaded at 0x400000, until it
+ *   ends, stops (syscall, break, a fault) or has executed N instructions
+ *   (--max-steps, default 100000000).  The reason it stopped, the number
+ *   of instructions executed and their rate, and the registers that are
+ *   not zero are printed instead of the assembly.
+ *   With --serve Binary keeps running and answers decode requests (see
+ *   DecodeServer.h for the protocol) on stdin and stdout, or on the
+ *   connections of a Unix domain socket at path, up to N at a time.  A
+ *   WORDS or TEXT request may carry at most N bytes (--max-payload,
+ *   default 16 MB).  The request latencies are printed on stderr when it
+ *   stops.
+ *   With --batch every input (a file, a directory, whose files are all
+ *   decoded, or @list, a file naming one input per line) is decoded on N
+ *   threads and written to its own file under dir, named after the input
+ *   with ".asm" added (see BatchDecoder.h).  A summary, naming the files
+ *   that were not correct, is printed on stderr, and the exit status is 1
+ *   if there were any.
+ *   With --histogram no assembly is printed.  Instead the instructions of
+ *   all the files are counted per opcode and type, along with the reads
+ *   and writes of each register, the range of each kind of immediate and
+ *   the share of branches and jumps (see UsageHistogram.h), and the totals
+ *   are printed, as a JSON object with --histogram=json.  With -j the
+ *   counting is split across N threads as well as the decoding.
+ *   With --async the input is read in large blocks several blocks ahead,
+ *   and the output of each block is written while the next ones are being
+ *   decoded, so that waiting for the disk overlaps with decoding (see
+ *   AsyncPipeline.h).  The reads and writes go through io_uring, or through
+ *   a reader and a writer thread if the kernel does not support it or
+ *   --async=threads is given.  As in streaming mode, the instructions before
+ *   a bad line have already been printed.
  */
 
+// Formats every Instruction held by parser on numThreads threads and writes
+// them to out in their original order.  Each chunk is written, and its
+// buffer freed, as soon as it and every chunk before it are formatted, so
+// output starts early and only the chunks in progress are held in memory.
+// Each chunk has its own assembly cache; their counts are added to the
+// parser's cache.
+static void writeParallel(BinaryParser *parser, OutputWriter& out, int numThreads) {
+  // Chunks are kept small enough that their buffers stay a few megabytes
+  const size_t maxChunkSize = 1 << 16;
+  size_t count = parser->getNumInstructions();
+  size_t numChunks = max((size_t)numThreads * 4, (count + maxChunkSize - 1) / maxChunkSize);
+  if (numChunks > count)
+    numChunks = (count == 0) ? 1 : count;
+
+  struct Chunk {
+    unique_ptr<OutputWriter> text;
+    AssemblyCache cache;
+    bool done = false;
+  };
+  vector<Chunk> chunks(numChunks);
+  size_t nextToWrite = 0;
+  mutex writeLock;
+  {
+    ThreadPool pool(numThreads);
+    for (size_t c = 0; c < numChunks; c++) {
+      size_t first = count / numChunks * c;
+      size_t last = (c + 1 == numChunks) ? count : count / numChunks * (c + 1);
+
+      pool.submit([parser, &out, &chunks, &nextToWrite, &writeLock, c, first, last]() {
+        Chunk& chunk = chunks[c];
+        chunk.text.reset(new OutputWriter(-1, FLUSH_WHEN_FULL, (last - first) * 64));
+        char assembly[BinaryParser::maxAssemblyLength];
+        for (size_t index = first; index < last; index++) {
+          Instruction i = parser->getInstruction(index);
+          string_view text;
+          if (!chunk.cache.lookup(i.getWord(), text)) {
+            int length = parser->formatAssembly(i, assembly);
+            text = chunk.cache.insert(i.getWord(), string_view(assembly, length));
+          }
+          chunk.text->appendEncodedLine(i.getWord(), text);
+        }
+
+        // Write out every chunk now complete, in order
+        lock_guard<mutex> guard(writeLock);
+        chunk.done = true;
+        while (nextToWrite < chunks.size() && chunks[nextToWrite].done) {
+          Chunk& next = chunks[nextToWrite];
+          out.append(next.text->getContents());
+          next.text.reset();
+          parser->getAssemblyCache().addCounts(next.cache);
+          nextToWrite++;
+        }
+      });
+    }
+    pool.wait();
+  }
+}
+
+// Writes assembled words to out as lines of '0'/'1' characters, or as raw
+// 4 byte words in the byte order of format
+static void writeWords(OutputWriter& out, const vector<uint32_t>& words, InputFormat format) {
+  for (uint32_t word : words) {
+    if (format == TEXT_INPUT) {
+      out.appendBinary(word);
+      out.endLine();
+      continue;
+    }
+
+    char bytes[4];
+    BinaryParser::packRawWord(word, format, bytes);
+    out.append(string_view(bytes, 4));
+  }
+}
+
+// Runs the Instructions held by parser on the simulator and prints the
+// outcome and the final registers
+static void runProgram(BinaryParser *parser, uint64_t maxSteps) {
+  vector<Instruction> program(parser->getNumInstructions());
+  for (size_t n = 0; n < program.size(); n++)
+    program[n] = parser->getInstruction(n);
+
+  Simulator simulator;
+  simulator.load(program.data(), program.size());
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  StopReason reason = simulator.run(maxSteps);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  uint64_t executed = simulator.getExecuted();
+  cout << "Stopped: " << Simulator::getStopDescription(reason) << " at 0x"
+       << hex << setw(8) << setfill('0') << simulator.getPC() << dec << setfill(' ') << endl;
+  cout << "Executed " << executed << " instructions in " << fixed << setprecision(6)
+       << seconds << " s (" << setprecision(1) << (seconds > 0 ? executed / seconds / 1e6 : 0)
+       << " Minst/s)" << endl;
+
+  for (int reg = 1; reg < NumRegisters; reg++)
+    if (simulator.getRegister(reg) != 0)
+      cout << RegisterTable::getName(reg) << "\t0x" << hex << setw(8) << setfill('0')
+           << simulator.getRegister(reg) << dec << setfill(' ') << "\t"
+           << (int32_t)simulator.getRegister(reg) << endl;
+  cout << "hi\t0x" << hex << setw(8) << setfill('0') << simulator.getHI()
+       << "\tlo\t0x" << setw(8) << simulator.getLO() << dec << setfill(' ') << endl;
+}
+
+// Reports every bad line found by a parser that collected its errors on
+// stderr, followed by a count.  Exits if the input could not be read at all.
+static void reportErrors(BinaryParser *parser) {
+  const vector<DecodeError>& errors = parser->getErrors();
+  if (!parser->isFormatCorrect() && errors.empty()) {
+    cerr << "Input file could not be read." << endl;
+    exit(1);
+  }
+
+  OutputWriter out(STDERR_FILENO, FLUSH_WHEN_FULL);
+  for (const DecodeError& error : errors) {
+    out.append("Line ");
+    out.appendDecimal(error.line);
+    out.append(", byte ");
+    out.appendDecimal(error.offset);
+    out.append(": ");
+    out.append(BinaryParser::getErrorDescription(error.reason));
+    if (error.reason == BAD_CHARACTER) {
+      out.append(" at column ");
+      out.appendDecimal(error.column);
+    }
+    out.endLine();
+  }
+  if (!errors.empty()) {
+    out.appendDecimal(errors.size());
+    out.append(errors.size() == 1 ? " bad line; " : " bad lines; ");
+    out.appendDecimal(parser->getNumInstructions());
+    out.append(" instructions decoded");
+    out.endLine();
+  }
+  out.flush();
+}
+
+// Decodes every input into outputDir and prints a summary on stderr.
+// Returns the exit status: 1 if any file was not correct.
+static int runBatch(const vector<char *>& inputs, string outputDir, InputFormat format,
+                    int numThreads) {
+  BatchDecoder decoder(outputDir, format, numThreads);
+  for (char *input : inputs)
+    if (!decoder.addInputs(input))
+      return 1;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  size_t failed = decoder.run();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  uint64_t numInstructions = 0, numBytes = 0;
+  size_t numChunks = 0, maxBuffered = 0;
+  for (const BatchResult& result : decoder.getResults()) {
+    numInstructions += result.numInstructions;
+    numBytes += result.size;
+    numChunks += result.numChunks;
+    maxBuffered = max(maxBuffered, result.maxBufferedChunks);
+    if (result.correct)
+      continue;
+
+    cerr << result.input << ": ";
+    if (!result.readable)
+      cerr << "cannot be read" << endl;
+    else if (!result.writable)
+      cerr << "cannot write " << result.output << endl;
+    else
+      cerr << "line " << result.error.line << ", byte " << result.error.offset << ": "
+           << BinaryParser::getErrorDescription(result.error.reason) << endl;
+  }
+
+  size_t numFiles = decoder.getResults().size();
+  cerr << numFiles - failed << " of " << numFiles << " files decoded, " << failed
+       << " incorrect; " << numInstructions << " instructions from " << numBytes
+       << " bytes in " << fixed << setprecision(3) << seconds << " s ("
+       << numChunks << " chunks on " << numThreads << " threads, "
+       << decoder.getSteals() << " steals, at most " << maxBuffered
+       << " chunks of a file buffered)" << defaultfloat << endl;
+  return failed > 0 ? 1 : 0;
+}
+
+// Counts the Instructions held by parser on numThreads threads into usage
+static void countParallel(BinaryParser *parser, UsageHistogram& usage, int numThreads) {
+  const vector<Instruction>& instructions = parser->getInstructions();
+  size_t count = instructions.size();
+  size_t numChunks = (size_t)numThreads;
+  if (numChunks > count)
+    numChunks = (count == 0) ? 1 : count;
+
+  vector<UsageHistogram> counts(numChunks);
+  {
+    ThreadPool pool(numThreads);
+    for (size_t c = 0; c < numChunks; c++) {
+      size_t first = count / numChunks * c;
+      size_t last = (c + 1 == numChunks) ? count : count / numChunks * (c + 1);
+      pool.submit([&instructions, &counts, c, first, last]() {
+        counts[c].add(instructions.data() + first, last - first);
+      });
+    }
+    pool.wait();
+  }
+
+  for (size_t c = 0; c < numChunks; c++)
+    usage.merge(counts[c]);
+}
+
+// Counts the instructions of every input and prints the totals on stdout.
+// Returns the exit status: 1 if an input was not correct.
+static int runHistogram(const vector<char *>& inputs, InputFormat format, int numThreads,
+                        bool streaming, bool json) {
+  UsageHistogram usage;
+
+  for (char *input : inputs) {
+    bool useStdin = (strcmp(input, "-") == 0);
+    ifstream file;
+    BinaryParser *parser;
+    if (streaming) {
+      if (!useStdin) {
+        file.open(input, ios::binary);
+        if (!file.is_open()) {
+          cerr << "Input file " << input << " could not be read." << endl;
+          return 1;
+        }
+      }
+      parser = new BinaryParser(useStdin ? cin : file, BinaryParser::defaultBatchSize, format);
+    }
+    else if (useStdin)
+      parser = new BinaryParser(cin, 0, format);
+    else
+      parser = new BinaryParser(input, format, numThreads);
+
+    if (streaming) {
+      for (Instruction i = parser->getNextInstruction(); i.getOpcode() != UNDEFINED;
+           i = parser->getNextInstruction())
+        usage.add(i);
+    }
+    else if (numThreads > 1)
+      countParallel(parser, usage, numThreads);
+    else
+      usage.add(parser->getInstructions().data(), parser->getNumInstructions());
+
+    bool correct = parser->isFormatCorrect();
+    delete parser;
+    if (!correct) {
+      cerr << "Format of input file " << input << " is incorrect." << endl;
+      return 1;
+    }
+  }
+
+  usage.report(cout, json);
+  return 0;
+}
+
+// Decodes the lines (or raw words) of one block of input and writes them
+// to out.  pending holds the incomplete line or word the previous block
+// ended with, and is left holding the one this block ends with.  Returns
+// false at the first bad line.
+static bool decodeBlock(BinaryParser& parser, string_view block, string& pending,
+                        InputFormat format, OutputWriter& out) {
+  Instruction i;
+  uint32_t word;
+  size_t pos = 0;
+
+  if (format != TEXT_INPUT) {
+    if (!pending.empty()) {
+      pos = min(4 - pending.length(), block.length());
+      pending.append(block.substr(0, pos));
+      if (pending.length() < 4)
+        return true;
+      if (!parser.decodeWord(BinaryParser::unpackRawWord(pending.data(), format), i))
+        return false;
+      out.appendEncodedLine(i.getWord(), parser.getAssembly(i));
+    }
+    for (; pos + 4 <= block.length(); pos += 4) {
+      if (!parser.decodeWord(BinaryParser::unpackRawWord(block.data() + pos, format), i))
+        return false;
+      out.appendEncodedLine(i.getWord(), parser.getAssembly(i));
+    }
+    pending.assign(block.substr(pos));
+    return true;
+  }
+
+  while (pos < block.length()) {
+    const char *end = (const char *)memchr(block.data() + pos, '\n', block.length() - pos);
+    if (end == NULL) {
+      // A line longer than an encoding is bad however it ends
+      pending.append(block.substr(pos));
+      return pending.length() <= 32;
+    }
+
+    string_view line = block.substr(pos, end - block.data() - pos);
+    pos = end - block.data() + 1;
+    if (!pending.empty()) {
+      pending.append(line);
+      line = pending;
+    }
+    if (!parser.checkInstSyntax(line, word) || !parser.decodeWord(word, i))
+      return false;
+    out.appendEncodedLine(i.getWord(), parser.getAssembly(i));
+    pending.clear();
+  }
+  return true;
+}
+
+// Decodes filename through an AsyncPipeline, so that reading the input and
+// writing the output overlap with decoding, and prints the assembly as in
+// streaming mode.  Returns the exit status.
+static int runAsync(char *filename, InputFormat format, AsyncMethod method) {
+  bool useStdin = (strcmp(filename, "-") == 0);
+  int fd = useStdin ? STDIN_FILENO : open(filename, O_RDONLY);
+  if (fd < 0) {
+    cerr << "Format of input file is incorrect." << endl;
+    return 1;
+  }
+
+  BinaryParser parser;
+  string pending;
+  bool correct = true;
+  bool ioCorrect;
+  {
+    AsyncPipeline pipeline(fd, STDOUT_FILENO, method);
+    string_view block;
+    while (correct && pipeline.nextBlock(block)) {
+      correct = decodeBlock(parser, block, pending, format, pipeline.getOutput());
+      pipeline.submitOutput();
+    }
+
+    // The last line need not end with a newline, but the last word must be whole
+    if (correct && !pipeline.hasError() && !pending.empty()) {
+      if (format == TEXT_INPUT)
+        correct = decodeBlock(parser, "\n", pending, format, pipeline.getOutput());
+      else
+        correct = false;
+      pipeline.submitOutput();
+    }
+    ioCorrect = pipeline.finish();
+  }
+  if (!useStdin)
+    close(fd);
+
+  if (!ioCorrect) {
+    cerr << "Input file could not be read or output could not be written." << endl;
+    return 1;
+  }
+  if (!correct) {
+    cerr << "Format of input file is incorrect." << endl;
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
   BinaryParser *parser;
+  bool streaming = false;
+  bool assemble = false;
+  bool run = false;
+  uint64_t maxSteps = 100000000;
+  InputFormat format = TEXT_INPUT;
+  int numThreads = 1;
+  bool cacheStats = false;
+  bool usePerf = false;
+  bool allErrors = false;
+  bool serve = false;
+  char *socketPath = NULL;
+  uint64_t maxPayload = DecodeServer::defaultMaxPayload;
+  bool batch = false;
+  char *outputDir = NULL;
+  vector<char *> inputs;
+  OutputFormat outputFormat = TEXT_OUTPUT;
+  bool histogram = false;
+  bool histogramJson = false;
+  bool async = false;
+  AsyncMethod asyncMethod = ASYNC_URING;
+  FlushPolicy flushPolicy = isatty(STDOUT_FILENO) ? FLUSH_EACH_LINE : FLUSH_WHEN_FULL;
+  char *filename = NULL;
+
+  for (int arg = 1; arg < argc; arg++) {
+    if (strcmp(argv[arg], "-s") == 0 || strcmp(argv[arg], "--stream") == 0)
+      streaming = true;
+    else if (strcmp(argv[arg], "-a") == 0 || strcmp(argv[arg], "--assemble") == 0)
+      assemble = true;
+    else if (strcmp(argv[arg], "--run") == 0)
+      run = true;
+    else if (strcmp(argv[arg], "--max-steps") == 0) {
+      arg++;
+      if (arg < argc)
+        maxSteps = strtoull(argv[arg], NULL, 10);
+    }
+    else if (strcmp(argv[arg], "-r") == 0 || strcmp(argv[arg], "--raw") == 0) {
+      arg++;
+      if (arg < argc && strcmp(argv[arg], "big") == 0)
+        format = RAW_BIG_ENDIAN;
+      else if (arg < argc && strcmp(argv[arg], "little") == 0)
+        format = RAW_LITTLE_ENDIAN;
+      else {
+        cerr << "Byte order for raw input must be big or little." << endl;
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[arg], "-j") == 0) {
+      arg++;
+      if (arg < argc)
+        numThreads = atoi(argv[arg]);
+      if (numThreads < 1) {
+        cerr << "Number of threads must be at least 1." << endl;
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[arg], "--cache-stats") == 0)
+      cacheStats = true;
+    else if (strcmp(argv[arg], "--stats") == 0 || strcmp(argv[arg], "--stats=json") == 0) {
+#ifdef DECODE_STATS
+      DecodeStats::enable(strcmp(argv[arg], "--stats=json") == 0);
+#else
+      cerr << "Statistics were not compiled in; rebuild with -DDECODE_STATS." << endl;
+      exit(1);
+#endif
+    }
+    else if (strcmp(argv[arg], "--perf") == 0)
+      usePerf = true;
+    else if (strcmp(argv[arg], "--all-errors") == 0)
+      allErrors = true;
+    else if (strcmp(argv[arg], "--serve") == 0)
+      serve = true;
+    else if (strcmp(argv[arg], "--socket") == 0) {
+      arg++;
+      if (arg < argc)
+        socketPath = argv[arg];
+    }
+    else if (strcmp(argv[arg], "--max-payload") == 0) {
+      arg++;
+      char *end = NULL;
+      if (arg < argc)
+        maxPayload = strtoull(argv[arg], &end, 10);
+      if (end == NULL || end == argv[arg] || *end != '\0' || maxPayload == 0) {
+        cerr << "Maximum payload size must be a positive number of bytes." << endl;
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[arg], "--format") == 0) {
+      arg++;
+      if (arg >= argc || !RecordWriter::parseFormat(argv[arg], outputFormat)) {
+        cerr << "Output format must be text, jsonl, csv or columnar." << endl;
+        exit(1);
+      }
+    }
+    else if (strcmp(argv[arg], "--histogram") == 0 || strcmp(argv[arg], "--histogram=json") == 0) {
+      histogram = true;
+      histogramJson = strcmp(argv[arg], "--histogram=json") == 0;
+    }
+    else if (strcmp(argv[arg], "--async") == 0 || strcmp(argv[arg], "--async=uring") == 0 ||
+             strcmp(argv[arg], "--async=threads") == 0) {
+      async = true;
+      asyncMethod = strcmp(argv[arg], "--async=threads") == 0 ? ASYNC_THREADS : ASYNC_URING;
+    }
+    else if (strcmp(argv[arg], "--batch") == 0)
+      batch = true;
+    else if (strcmp(argv[arg], "-o") == 0 || strcmp(argv[arg], "--output-dir") == 0) {
+      arg++;
+      if (arg < argc)
+        outputDir = argv[arg];
+    }
+    else if (strcmp(argv[arg], "--flush") == 0) {
+      arg++;
+      if (arg < argc && strcmp(argv[arg], "line") == 0)
+        flushPolicy = FLUSH_EACH_LINE;
+      else if (arg < argc && strcmp(argv[arg], "full") == 0)
+        flushPolicy = FLUSH_WHEN_FULL;
+      else {
+        cerr << "Flush policy must be line or full." << endl;
+        exit(1);
+      }
+    }
+    else {
+      filename = argv[arg];
+      inputs.push_back(argv[arg]);
+    }
+  }
+
+  // Records are only written by the decoding paths below
+  if (outputFormat != TEXT_OUTPUT && (serve || batch || histogram || assemble || run)) {
+    cerr << "--format cannot be combined with --serve, --batch, --histogram, -a or --run." << endl;
+    exit(1);
+  }
+
+  if (serve) {
+    // A client that goes away must not take the server down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    DecodeServer server(numThreads, maxPayload);
+    if (socketPath != NULL) {
+      if (!server.serveSocket(socketPath))
+        exit(1);
+    }
+    else
+      server.serveStream(STDIN_FILENO, STDOUT_FILENO);
+    server.report(cerr);
+    return 0;
+  }
+
+  if (batch) {
+    if (outputDir == NULL || inputs.empty()) {
+      cerr << "Batch mode needs an output directory (-o) and at least one input." << endl;
+      exit(1);
+    }
+    return runBatch(inputs, outputDir, format, numThreads);
+  }
+
+  if (histogram) {
+    if (inputs.empty()) {
+      cerr << "Need to specify an encoded file to count." << endl;
+      exit(1);
+    }
+    return runHistogram(inputs, format, numThreads, streaming, histogramJson);
+  }
 
-  if (argc < 2) {
+  if (filename == NULL) {
     cerr << "Need to specify an encoded file to translate."<< endl;
     exit(1);
   }
 
-  parser = new BinaryParser(argv[1]);
+  if (async) {
+    if (assemble || run || streaming || allErrors || numThreads > 1 || outputFormat != TEXT_OUTPUT) {
+      cerr << "--async cannot be combined with -a, --run, -s, -j, --all-errors or --format." << endl;
+      exit(1);
+    }
+    return runAsync(filename, format, asyncMethod);
+  }
 
-  if (parser->isFormatCorrect() == false) {
+  if (assemble) {
+    Assembler assembler(filename);
+    if (!assembler.isFormatCorrect()) {
+      cerr << "Format of input file is incorrect." << endl;
+      exit(1);
+    }
+
+    OutputWriter out(STDOUT_FILENO, flushPolicy);
+    writeWords(out, assembler.getWords(), format);
+    if (!out.flush() || out.hasError()) {
+      cerr << "Output could not be written." << endl;
+      exit(1);
+    }
+    return 0;
+  }
+
+  if (outputFormat == COLUMNAR_OUTPUT && streaming) {
+    cerr << "The columnar format cannot be streamed." << endl;
+    exit(1);
+  }
+
+  if (allErrors && streaming) {
+    cerr << "--all-errors cannot be combined with streaming." << endl;
+    exit(1);
+  }
+
+  // Whole files are memory mapped by the parser; stdin and streaming
+  // mode read through an input stream instead
+  ifstream file;
+  bool useStdin = (strcmp(filename, "-") == 0);
+  if (streaming && !useStdin) {
+    file.open(filename, ios::binary);
+    if (!file.is_open()) {
+      cerr << "Format of input file is incorrect." << endl;
+      exit(1);
+    }
+  }
+
+  // Hardware counters for decoding the input and for producing the output
+  PerfCounters *decodePerf = NULL, *outputPerf = NULL;
+  if (usePerf) {
+    decodePerf = new PerfCounters();
+    outputPerf = new PerfCounters();
+    decodePerf->start();
+  }
+
+  if (streaming)
+    parser = new BinaryParser(useStdin ? cin : file, BinaryParser::defaultBatchSize, format);
+  else if (allErrors)
+    parser = new BinaryParser(useStdin ? "/dev/stdin" : filename, format, numThreads, true);
+  else if (useStdin)
+    parser = new BinaryParser(cin, 0, format);
+  else
+    parser = new BinaryParser(filename, format, numThreads);
+
+  if (usePerf) {
+    decodePerf->stop();
+    outputPerf->start();
+  }
+
+  if (allErrors)
+    reportErrors(parser);
+  else if (parser->isFormatCorrect() == false) {
     cerr << "Format of input file is incorrect." << endl;
     exit(1);
   }
 
-  Instruction i;
+  if (run) {
+    if (streaming) {
+      cerr << "A program cannot be run in streaming mode." << endl;
+      exit(1);
+    }
+    if (parser->isFormatCorrect() == false)
+      exit(1);
+    runProgram(parser, maxSteps);
+    delete parser;
+    return 0;
+  }
 
-  // Iterate through instructions, printing each encoding.
-  i = parser->getNextInstruction();
-  while (i.getOpcode() != UNDEFINED) {
-    cout << i.getEncoding() << "\t" << i.getAssembly() << endl;
+  OutputWriter out(STDOUT_FILENO, flushPolicy);
+  uint64_t numInstructions = parser->getNumInstructions();
+
+  if (outputFormat != TEXT_OUTPUT) {
+    RecordWriter records(out, outputFormat);
+    if (!streaming)
+      records.writeAll(parser->getInstructions());
+    else {
+      records.writeHeader();
+      numInstructions = 0;
+      for (Instruction i = parser->getNextInstruction(); i.getOpcode() != UNDEFINED;
+           i = parser->getNextInstruction()) {
+        records.write(i);
+        numInstructions++;
+      }
+    }
+  }
+  else if (numThreads > 1 && !streaming) {
+    writeParallel(parser, out, numThreads);
+  }
+  else {
+    Instruction i;
+
+    // Iterate through instructions, printing each encoding.
     i = parser->getNextInstruction();
+    numInstructions = 0;
+    while (i.getOpcode() != UNDEFINED) {
+      out.appendEncodedLine(i.getWord(), parser->getAssembly(i));
+      numInstructions++;
+      i = parser->getNextInstruction();
+    }
+  }
+  // A failed write may have happened at any flush, not only this last one
+  if (!out.flush() || out.hasError()) {
+    cerr << "Output could not be written." << endl;
+    exit(1);
+  }
+
+  if (usePerf) {
+    outputPerf->stop();
+    decodePerf->report(cerr, "decode", numInstructions);
+    outputPerf->report(cerr, "output", numInstructions);
+    delete decodePerf;
+    delete outputPerf;
+  }
+
+  // When streaming, a bad line may only be found partway through the input
+  if (parser->isFormatCorrect() == false && !allErrors) {
+    cerr << "Format of input file is incorrect." << endl;
+    exit(1);
+  }
+
+  if (cacheStats) {
+    AssemblyCache& cache = parser->getAssemblyCache();
+    cerr << "Assembly cache: " << cache.getHits() << " hits, " << cache.getMisses()
+         << " misses, " << cache.getCapacity() << " entries" << endl;
+  }
+
+  // The bad lines have been reported; the good ones were still printed
+  if (parser->isFormatCorrect() == false) {
+    delete parser;
+    exit(1);
   }
   
   delete parser;
-}
\ No newline at end of file
+}
@@ -1,433 +1,523 @@
 #include "BinaryParser.h"
+#include <array>
+#include <charconv>
+#include <utility>
+#include <string.h>
+
+// Creates a parser holding no Instructions, for decoding words one at a
+// time with checkInstSyntax() and decodeWord()
+BinaryParser::BinaryParser() {
+  myFormatCorrect = true;
+  myIndex = 0;
+  myInput = NULL;
+  myBatchSize = 0;
+  myFormat = TEXT_INPUT;
+}
 
 // Specify a text file containing encoded MIPS assembly. Function
 // checks syntactic correctness of file and creates a list of Instructions.
-BinaryParser::BinaryParser(string filename) {
-  Instruction i;
+BinaryParser::BinaryParser(string filename, InputFormat format, int numThreads,
+                           bool collectErrors) {
   myFormatCorrect = true;
+  myIndex = 0;
+  myInput = NULL;
+  myBatchSize = 0;
+  myFormat = format;
 
   // Try to open the input file
-  ifstream in;
-  in.open(filename.c_str());
+  MappedFile in(filename);
 
   // There was a problem opening the file
-  if (in.bad())
+  if (!in.isOpen()) {
     myFormatCorrect = false;
-  else {
-    string line;
-    //For every instruction in the input file
-    while (getline(in, line)) {
-      // Check the syntax of the line
-      if (!checkInstSyntax(line)) {
-        myFormatCorrect = false;
-        break;
-      }
+    return;
+  }
 
-      //Get the opcode field and function field
-      string opcode_field = getOpcodeField(line);
-      string func_field = getFuncField(line);
+  // Raw input is a sequence of whole 4 byte words; when collecting errors
+  // a trailing partial word is reported and the whole words still decoded
+  size_t size = in.getSize();
+  if (myFormat != TEXT_INPUT && size % rawWordLength != 0) {
+    if (!collectErrors) {
+      myFormatCorrect = false;
+      return;
+    }
+    size -= size % rawWordLength;
+  }
 
-      // Get the opcode as an enum Opcode & check its validity
-      Opcode opcode = opcodes.getOpcode(opcode_field, func_field);
-      // Use the opcode to get the name of the opcode in 
-      // string form.
-      string opcodeName = opcodes.getOpcodeName(opcode);
+  if (numThreads > 1)
+    myFormatCorrect = decodeParallel(in, numThreads, collectErrors);
+  else {
+    myFormatCorrect = decodeRange(in, 0, size, myInstructions,
+                                  collectErrors ? &myErrors : NULL, NULL);
+    for (DecodeError& error : myErrors)
+      error.line++;
+  }
 
-      // Check opcode's validity
-      if (opcode == UNDEFINED) {
-        myFormatCorrect = false;
-        break;
-      }
+  if (size != in.getSize()) {
+    DecodeError error = { size / rawWordLength + 1, size, 0, BAD_LENGTH };
+    myErrors.push_back(error);
+  }
+  if (!myErrors.empty())
+    myFormatCorrect = false;
 
-      // Use the opcode to determine instruction type
-      InstType instType = opcodes.getInstType(opcode);
-      // Get the line (w/o the opocode) of the instruction, to pass into the decode function
-      string lineWithoutOpcode = getLineNoOpcode(line); //naming
+  // Nothing is kept from a file with a bad line, unless errors are collected
+  if (!myFormatCorrect && !collectErrors)
+    myInstructions.clear();
+}
 
-      // The instruction type determines how we decode the binary string
-      bool success;
-      switch (instType) {
-        case RTYPE:
-          success = decodeRType(i, opcode, opcodeName, lineWithoutOpcode);
-          break;
-        case ITYPE:
-          success = decodeIType(i, opcode, opcodeName, lineWithoutOpcode);
-          break;
-        case JTYPE:
-          success = decodeJType(i, opcode, opcodeName, lineWithoutOpcode);
-          break;
-      }
-      // Did the decoding process work correctly
-      if (!success) {
-        myFormatCorrect = false;
-        break;
+// This function decodes the lines (or raw words) in the byte range
+// [start, end) of in, appending them to out.  Returns false as soon as a
+// bad line is found, or if cancelled is set by another thread.  If errors
+// is not NULL, bad lines are appended to it instead and decoding goes on;
+// their line numbers count from 0 at start.
+bool BinaryParser::decodeRange(MappedFile& in, size_t start, size_t end, vector<Instruction>& out,
+                               vector<DecodeError> *errors, atomic<bool> *cancelled) {
+  Instruction i;
+  size_t firstLine = out.size() + (errors != NULL ? errors->size() : 0);
+
+  if (myFormat != TEXT_INPUT) {
+    for (size_t pos = start; pos < end; pos += rawWordLength) {
+      if (cancelled != NULL && cancelled->load(memory_order_relaxed))
+        return false;
+      uint32_t word = unpackRawWord(in.getData() + pos, myFormat);
+      if (!decodeWord(word, i)) {
+        if (errors == NULL)
+          return false;
+        DecodeError error = { (pos - start) / rawWordLength, pos, 0, diagnoseWord(word) };
+        errors->push_back(error);
+        continue;
       }
+      out.push_back(i);
+    }
+    return true;
+  }
 
-      // Set the line as the instruction's encoding
-      i.setEncoding(line);
+  string_view line;
+  size_t pos = start;
 
-      // Create MIPS assembly string
-      string assemblyInstruction = createAssemblyCode(i);
+  //For every instruction in the range
+  while (in.getNextLine(pos, end, line)) {
+    if (cancelled != NULL && cancelled->load(memory_order_relaxed))
+      return false;
+    if (!decodeLine(line, i)) {
+      if (errors == NULL)
+        return false;
+
+      // Every line is either decoded or an error, so together they count
+      // the lines read so far
+      DecodeError error = diagnoseLine(line);
+      error.line = out.size() + errors->size() - firstLine;
+      error.offset = line.data() - in.getData();
+      errors->push_back(error);
+      continue;
+    }
 
-      // Set the assembly string into the instruction instance
-      i.setAssembly(assemblyInstruction);
+    // Add it to our vector of instructions
+    out.push_back(i);
+  }
+  return true;
+}
 
-      // Add it to our vector of instructions
-      myInstructions.push_back(i);
+// This function splits in into chunks and decodes them on numThreads
+// threads, storing the Instructions in file order.  Returns false, with
+// the remaining chunks cancelled, as soon as any chunk has a bad line.
+// With collectErrors no chunk is cancelled, and the bad lines of every
+// chunk are gathered into myErrors.
+bool BinaryParser::decodeParallel(MappedFile& in, int numThreads, bool collectErrors) {
+  size_t size = in.getSize();
+  if (myFormat != TEXT_INPUT)
+    size -= size % rawWordLength;
+  size_t numChunks = (size_t)numThreads * chunksPerThread;
+  if (numChunks > size / minChunkSize)
+    numChunks = size / minChunkSize;
+  if (numChunks < 1)
+    numChunks = 1;
+
+  // Chunk boundaries fall on line starts (or word starts for raw input)
+  vector<size_t> bounds;
+  bounds.push_back(0);
+  for (size_t c = 1; c < numChunks; c++) {
+    size_t offset = size / numChunks * c;
+    if (myFormat == TEXT_INPUT)
+      offset = in.findLineStart(offset);
+    else
+      offset -= offset % rawWordLength;
+    bounds.push_back(offset);
+  }
+  bounds.push_back(size);
+
+  vector<vector<Instruction> > results(numChunks);
+  vector<vector<DecodeError> > errors(collectErrors ? numChunks : 0);
+  atomic<bool> cancelled(false);
+  {
+    ThreadPool pool(numThreads);
+    for (size_t c = 0; c < numChunks; c++) {
+      pool.submit([this, &in, &bounds, &results, &errors, &cancelled, collectErrors, c]() {
+        if (!decodeRange(in, bounds[c], bounds[c + 1], results[c],
+                         collectErrors ? &errors[c] : NULL, &cancelled))
+          cancelled.store(true);
+      });
     }
+    pool.wait();
   }
-  myIndex = 0;
-}
 
-// This function checks the syntax of a binary MIPS instruction
-bool BinaryParser::checkInstSyntax(string inst) {
-  // All lines must be 32 bits long
-  int len = inst.length();
-  if (len != encodedInstLength)
+  if (cancelled.load())
     return false;
 
-  // If any of those bits aren't a 1 or 0, return false
-  int pos = 0;
-  while (pos < len) {
-    char c = inst.at(pos);
-    if (!isOneOrZero(c))
-      return false;
-    pos++;
+  // Reassemble the chunks in their original order
+  size_t total = 0;
+  for (size_t c = 0; c < numChunks; c++)
+    total += results[c].size();
+  myInstructions.reserve(total);
+  for (size_t c = 0; c < numChunks; c++)
+    myInstructions.insert(myInstructions.end(), results[c].begin(), results[c].end());
+
+  // Line numbers within a chunk become line numbers within the file
+  size_t firstLine = 1;
+  for (size_t c = 0; c < errors.size(); c++) {
+    for (DecodeError& error : errors[c]) {
+      error.line += firstLine;
+      myErrors.push_back(error);
+    }
+    firstLine += results[c].size() + errors[c].size();
   }
-  return true;
-}
 
-// This function receives a 32 bit line representing a MIPS instruction,
-// and returns the opcode field of that instruction
-string BinaryParser::getOpcodeField(string line) {
-  int pos = 0; // position in line
+  return myErrors.empty();
+}
 
-  // create opcode field string
-  string opcodeField = "";
-  while (pos < opcodeLength) {
-    opcodeField += line.at(pos);
-    pos++;
+// This function works out why a line that failed to decode is bad.  Only
+// the reason and column of the result are filled in.
+DecodeError BinaryParser::diagnoseLine(string_view line) {
+  DecodeError error = { 0, 0, 0, BAD_LENGTH };
+  if (line.length() != encodedInstLength)
+    return error;
+
+  uint32_t word = 0;
+  for (size_t n = 0; n < line.length(); n++) {
+    if (line[n] != '0' && line[n] != '1') {
+      error.column = n + 1;
+      error.reason = BAD_CHARACTER;
+      return error;
+    }
+    word = (word << 1) | (line[n] - '0');
   }
-  return opcodeField;
+
+  error.reason = diagnoseWord(word);
+  return error;
 }
 
-// This function receives a 32 bit line representing a MIPS instruction
-// and returns the last 6 bits, where the function field of an RTYPE 
-// command is located.
-string BinaryParser::getFuncField(string line) {
-  unsigned int pos = funcFieldLocation; // position in line
-
-  // create function field string
-  string funcField = "";
-  while (pos < line.length()) {
-    funcField += line.at(pos);
-    pos++;
+// This function works out why a word that failed to decode is bad
+DecodeErrorReason BinaryParser::diagnoseWord(uint32_t word) {
+  switch ((word >> opcodeShift) & fieldMask) {
+    case specialOpcode:
+      return UNKNOWN_FUNCT;
+    case regimmOpcode:
+      return UNKNOWN_REGIMM;
+    default:
+      return UNKNOWN_OPCODE;
   }
-  return funcField;
 }
 
-// This function receives a 32b line representing a MIPS instruction,
-// and returns the instruction without the 6b opcode.
-string BinaryParser::getLineNoOpcode(string line) {
-  string instWithoutOpcode = "";
-  int pos = opcodeLength; // Position in line
-
-  // Create the line with no opcode
-  while (pos < line.length()) {
-    instWithoutOpcode += line.at(pos);
-    pos++;
+// Returns a short description of reason
+string BinaryParser::getErrorDescription(DecodeErrorReason reason) {
+  switch (reason) {
+    case BAD_LENGTH:
+      return "wrong length";
+    case BAD_CHARACTER:
+      return "character other than 0 or 1";
+    case UNKNOWN_OPCODE:
+      return "unknown opcode";
+    case UNKNOWN_FUNCT:
+      return "unknown funct field";
+    case UNKNOWN_REGIMM:
+      return "unknown REGIMM rt field";
   }
-  return instWithoutOpcode; 
+  return "unknown error";
 }
 
+// Streaming mode: instructions are read from the given stream and decoded
+// batchSize lines at a time as getNextInstruction() asks for them, so
+// memory use does not depend on the length of the input. A batchSize of
+// 0 reads the whole stream up front like the filename constructor.
+BinaryParser::BinaryParser(istream& in, int batchSize, InputFormat format) {
+  myFormatCorrect = true;
+  myIndex = 0;
+  myInput = NULL;
+  myBatchSize = batchSize;
+  myFormat = format;
 
+  if (in.bad())
+    myFormatCorrect = false;
+  else if (batchSize == 0)
+    readInstructions(in, 0);
+  else
+    myInput = &in;
+}
 
-// This function separates an RType instruction into the fields needed to 
-// print the assembly representation.
-bool BinaryParser::decodeRType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode) {
-  string rd, rs, rt, imm = "";
-  int imm_r = 0;
+// This function reads and decodes up to maxCount lines (all remaining
+// lines if maxCount is 0) from in, replacing the current list of Instructions.
+void BinaryParser::readInstructions(istream& in, int maxCount) {
+  Instruction i;
+  string line;
+  int count = 0;
 
-  // Each register's position in this instruction
-  int rd_p = opcodes.RDposition(opcode);
-  int rs_p = opcodes.RSposition(opcode);
-  int rt_p = opcodes.RTposition(opcode);
-  int imm_p = opcodes.IMMposition(opcode);
+  myInstructions.clear();
+  myIndex = 0;
 
-  // At this step, we create strings containing the binary value of each register, given its
-  // present in our command
-  int pos = 0;
-  
-  // If the command includes the register, convert that register to decimal
-  // If the position is -1, it isn't included in this example
-  if (rs_p != -1)
-    rs = convertRegisterToAssembly(lineWithoutOpcode, pos, registerLength);
-  pos += registerLength;
-
-  if (rt_p != -1)
-    rt = convertRegisterToAssembly(lineWithoutOpcode, pos, pos + registerLength);
-  pos += registerLength;
-
-  if (rd_p != -1)
-    rd = convertRegisterToAssembly(lineWithoutOpcode, pos, pos + registerLength);
-  pos += registerLength;
-
-  // If present, get the binary string of the integer and convert it to an integer
-  if (imm_p != -1) {
-    while (pos < lineWithoutOpcode.length() - opcodeLength) { //opcode length = funcfield length
-      imm += lineWithoutOpcode.at(pos);
-      pos++;
+  //For every instruction in the input file
+  while (maxCount == 0 || count < maxCount) {
+    bool decoded;
+    if (myFormat == TEXT_INPUT) {
+      {
+        STATS_PHASE(PHASE_READ);
+        if (!getline(in, line))
+          break;
+        STATS_BYTES_READ(line.length() + 1);
+      }
+      decoded = decodeLine(line, i);
+    }
+    else {
+      char bytes[rawWordLength];
+      {
+        STATS_PHASE(PHASE_READ);
+        in.read(bytes, rawWordLength);
+        STATS_BYTES_READ(in.gcount());
+      }
+      if (in.gcount() == 0)
+        break;
+      // A trailing partial word is a format error
+      decoded = (in.gcount() == rawWordLength) && decodeWord(unpackRawWord(bytes, myFormat), i);
     }
-    // function stoi() converts a binary string to an integer
-    imm_r = stoi(imm, nullptr, 2);
-  }
-
-  // set the values of the instruction instance corresponding to this line
-  i.setValues(opcode, op_name, rs, rt, rd, imm_r);
-  
-  return true;
-}
 
-// This function separates an IType instruction into the fields needed to 
-// print the assembly representation.
-bool BinaryParser::decodeIType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode) {
-  string rt, rs, imm;
-  int imm_r = 0;
-
-  // No rd register in ITYPE commands
-  string rd = "";
-
-  // Get register and imm positions based on this instruction's opcode
-  int rs_p = opcodes.RSposition(opcode);
-  int rt_p = opcodes.RTposition(opcode);
-  int imm_p = opcodes.IMMposition(opcode);
-
-  // At this step, we create strings containing the binary value of each register, given its
-  // present in our command
-  int pos = 0;
-  if (rs_p != -1)
-    rs = convertRegisterToAssembly(lineWithoutOpcode, pos, registerLength);
-  pos += registerLength;
-
-  if (rt_p != -1)
-    rt = convertRegisterToAssembly(lineWithoutOpcode, pos, (pos + registerLength));
-  pos += registerLength;
-
-  // If present, get the string of the immediate field and convert it from two's complement to decimal
-  if (imm_p != -1) {
-    while (pos < lineWithoutOpcode.length()) {
-      imm += lineWithoutOpcode.at(pos);
-      pos++;
+    if (!decoded) {
+      myFormatCorrect = false;
+      break;
     }
-    imm_r = convertTwosComplementToDecimal(imm);
-  }
 
-  i.setValues(opcode, op_name, rs, rt, rd, imm_r);
-  
-  return true;
+    // Add it to our vector of instructions
+    myInstructions.push_back(i);
+    count++;
+  }
 }
- 
-// This function separates an JType instruction into the fields needed to 
-// print the assembly representation.
-bool BinaryParser::decodeJType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode) { //use reference for string
-  string rd, rt, rs, imm = "";
-  int imm_r = 0;
-
-  int imm_p = opcodes.IMMposition(opcode);
-  int pos = 0;
-
-  if (imm_p != -1) {
-    while (pos < lineWithoutOpcode.length()) {
-      imm += lineWithoutOpcode.at(pos);
-      pos++;
-    }
-    imm_r = stoi(imm, nullptr, 2);
+
+// This function checks and decodes a single line of the input into i.
+// Returns false if the line is not a valid encoded instruction.
+bool BinaryParser::decodeLine(string_view line, Instruction& i) {
+  // Check the syntax of the line, packing its 32 characters into a
+  // single word; every field is extracted from it with shifts and masks
+  uint32_t word;
+  {
+    STATS_PHASE(PHASE_VALIDATE);
+    if (!checkInstSyntax(line, word))
+      return false;
   }
 
-  i.setValues(opcode, op_name, rs, rt, rd, imm_r);
-  
-  return true;
+  return decodeWord(word, i);
 }
 
-// This function returns a string representing the assembly code of
-// a single MIPS instruction
-string BinaryParser::createAssemblyCode(Instruction i) {
-  Opcode opcode = i.getOpcode();
-  string opcodeString = opcodes.getOpcodeName(opcode);
-  InstType type = opcodes.getInstType(opcode);
-
-  switch (type) {
-    case RTYPE:
-      return writeRTypeDecoded(i); // put all necessary info into the instruction instance
-    case JTYPE:
-      return writeJTypeDecoded(i);
-    case ITYPE:
-      return writeITypeDecoded(i);
-  }
+// Field decoders generated from isaSpec: decodeFields<O> extracts exactly
+// the fields that instruction O uses, so decoding a word is a table lookup
+// and a call with no per-field tests at run time.
+template <size_t O>
+static void decodeFields(uint32_t word, Instruction& i) {
+  constexpr OpcodeSpec spec = isaSpec[O];
+  int rs = NumRegisters, rt = NumRegisters, rd = NumRegisters;
+  int imm = 0;
+
+  if constexpr (spec.usesRS())
+    rs = (word >> rsShift) & registerMask;
+  if constexpr (spec.usesRT())
+    rt = (word >> rtShift) & registerMask;
+  if constexpr (spec.usesRD())
+    rd = (word >> rdShift) & registerMask;
+
+  constexpr OperandKind immKind = spec.immediateKind();
+  if constexpr (immKind == OPERAND_SHAMT)
+    imm = (word >> shamtShift) & registerMask;
+  else if constexpr (immKind == OPERAND_UIMM)
+    imm = word & immediateMask;
+  else if constexpr (immKind == OPERAND_TARGET)
+    imm = word & addressMask;
+  else if constexpr (immKind != OPERAND_NONE)
+    imm = (int16_t)(word & immediateMask);  // sign extend the two's complement field
+
+  i.setValues((Opcode)O, rs, rt, rd, imm);
 }
 
-// This function uses the RType fields to set the values of an instruction data type
-string BinaryParser::writeRTypeDecoded(Instruction i) {
-  string assembly = i.getOpcodeName() + '\t';
-  Opcode opcode = i.getOpcode();
+typedef void (*FieldDecoder)(uint32_t word, Instruction& i);
 
-  // If register is present, add it to the assembly string.
-  if (opcodes.RDposition(opcode) != -1) {
-    Register rd = i.getRD();
-    // If it is first, print with a space preceeding and a comma afterwards
-    if (opcodes.RDposition(opcode) != 0)
-      assembly += ' ' + rd + ',';
-    // Otherwise, simply print with a comma afterwards
-    else
-      assembly += rd + ',';
-  }
-  if (opcodes.RSposition(opcode) != -1) {
-    Register rs = i.getRS();
-    if (opcodes.RSposition(opcode) != 0)
-      assembly += ' ' + rs + ',';
-    else
-      assembly += rs + ',';
-  }
-  if (opcodes.RTposition(opcode) != -1) {
-    Register rt = i.getRT();
-    if (opcodes.RTposition(opcode) != 0)
-      assembly += ' ' + rt + ',';
-    else
-      assembly += rt + ',';
+template <size_t... O>
+static constexpr array<FieldDecoder, UNDEFINED> makeFieldDecoders(index_sequence<O...>) {
+  return {{ decodeFields<O>... }};
+}
+
+// The field decoder of every Opcode
+static constexpr array<FieldDecoder, UNDEFINED> fieldDecoders =
+  makeFieldDecoders(make_index_sequence<UNDEFINED>());
+
+// This function decodes a single 32 bit instruction word into i.
+// Returns false if the word is not a supported instruction.
+bool BinaryParser::decodeWord(uint32_t word, Instruction& i) {
+  // Get the opcode as an enum Opcode & check its validity
+  Opcode opcode;
+  {
+    STATS_PHASE(PHASE_LOOKUP);
+    opcode = opcodes.getOpcode(word);
   }
+  if (opcode == UNDEFINED)
+    return false;
 
-  if (opcodes.IMMposition(opcode) != -1) {
-    int imm = i.getImmediate();
-    assembly += ' ' + to_string(imm); // Immediate would always be last if present
+  // Extract the fields this instruction uses
+  {
+    STATS_PHASE(PHASE_DECODE);
+    fieldDecoders[opcode](word, i);
   }
+  STATS_OPCODE(opcode);
 
-  // If there is a stray comma at the end, remove it
-  if (assembly[assembly.length() - 1] == ',')
-    assembly.pop_back();
+  // Keep the word as the instruction's encoding
+  i.setWord(word);
 
-  return assembly;
+  return true;
 }
 
-// This function uses the IType fields to set the values of an instruction data type
-string BinaryParser::writeITypeDecoded(Instruction i) {
-  Opcode opcode = i.getOpcode();
-  stringstream assembly;
-  assembly << i.getOpcodeName() << "\t";
-  Register rt, rs;
-
-  if (opcodes.RTposition(opcode) != -1) {
-    rt = i.getRT();
-    if (opcodes.RTposition(opcode) == 2)
-      assembly << rt;
-    else
-      assembly << rt << ", ";
-  }
+// This function assembles a 32 bit word from 4 raw input bytes in the
+// byte order of format (RAW_BIG_ENDIAN or RAW_LITTLE_ENDIAN)
+uint32_t BinaryParser::unpackRawWord(const char *bytes, InputFormat format) {
+  const unsigned char *b = (const unsigned char *)bytes;
+  if (format == RAW_LITTLE_ENDIAN)
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
 
-  if (opcodes.RSposition(opcode) != -1) {
-    rs = i.getRS();
-    if (opcodes.RSposition(opcode) == 2)
-      assembly << rs;
-    else
-      assembly << rs << ", ";
-  }
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
 
-  string assemblyString;
-  if (opcodes.IMMposition(opcode) != -1) {
-    int imm = i.getImmediate();
-
-    // Case to handle instructions that handle memory
-    if (opcodes.isMemoryInstr(opcode)) {
-      string immString = to_string(imm);
-      assembly << immString;
-      assemblyString = assembly.str();
-      string::iterator it;
-      int index = assemblyString.length() - 1;
-      for (it = assemblyString.end(); it > assemblyString.begin(); it--, index--) {
-        if (assemblyString.at(index) == ' ') {
-          assemblyString.insert(index, ' ' + immString + '(' + rs + ')');
-          break;
-        }
-        else
-          assemblyString.pop_back();
-      }
-      return assemblyString;
-    }
-    // Case to handle instructions that have a label in the imm field
-    else if (opcodes.isIMMLabel(opcode)) {
-      imm *= 4;
-      // Convert integer representing address to hexadecimal
-      assembly << "0x" << hex << imm;
-    }
-    // Any other cases simply require us to add the immediate to the assembly string
-    else {
-      assembly << imm;
-    }
+// This function stores word as 4 raw bytes in the byte order of format,
+// the reverse of unpackRawWord()
+void BinaryParser::packRawWord(uint32_t word, InputFormat format, char *bytes) {
+  for (int b = 0; b < rawWordLength; b++) {
+    int shift = (format == RAW_LITTLE_ENDIAN) ? 8 * b : 24 - 8 * b;
+    bytes[b] = (char)(word >> shift);
   }
-  return assembly.str();
 }
 
-// This function uses the JType fields to set the values of an instruction data type
-string BinaryParser:: writeJTypeDecoded(Instruction i) {
-  Opcode opcode = i.getOpcode();
-  stringstream assembly;
-  assembly << i.getOpcodeName() << "\t";
+// This function checks the syntax of a binary MIPS instruction and, if it
+// is correct, packs its 32 characters into word (most significant bit first).
+bool BinaryParser::checkInstSyntax(string_view inst, uint32_t& word) {
+  // All lines must be 32 bits long
+  if (inst.length() != encodedInstLength)
+    return false;
 
-  if (opcodes.IMMposition(opcode) != -1) {
-    int imm = i.getImmediate();
-    imm *= 4;
+  // Every character must be a 1 or 0; validated and packed in one step
+  return packer.pack(inst.data(), word);
+}
 
-    // Convert integer representing address to hexadecimal
-    assembly << "0x" << hex << imm;
-  }
-  return assembly.str();
+// Returns the MIPS assembly text of an Instruction returned by
+// getNextInstruction().  The text is formatted on first use and kept in
+// a cache keyed by the instruction word, so repeated words are only
+// formatted once.  The view is valid until the next call.
+string_view BinaryParser::getAssembly(const Instruction& i) {
+  string_view text;
+  if (myAssemblyCache.lookup(i.getWord(), text))
+    return text;
+
+  int length = formatAssembly(i, myUncachedAssembly);
+  return myAssemblyCache.insert(i.getWord(), string_view(myUncachedAssembly, length));
 }
 
-// This function converts a binary register value into a decimal string
-string BinaryParser::convertRegisterToAssembly(string& reg, int start, int finish) {
-  int pos = start;
-  string binaryRegister = "";
+// Small helpers that format directly into a character buffer and return
+// the position just past what they wrote.
+static char *writeText(char *out, string_view text) {
+  memcpy(out, text.data(), text.length());
+  return out + text.length();
+}
 
-  while (pos < finish) {
-    binaryRegister += reg.at(pos);
-    pos++;
-  }
-  
-  int decimalRegister = stoi(binaryRegister, nullptr, 2);
-  string assemblyRegister = "$" + to_string(decimalRegister);
+static char *writeDecimal(char *out, int value) {
+  return to_chars(out, out + 12, value).ptr;
+}
 
-  return assemblyRegister;
+static char *writeHex(char *out, uint32_t value) {
+  return to_chars(out, out + 8, value, 16).ptr;
 }
 
-// This function converts a binary string in two's complement
-// into a decimal value (as a string). Used in IType conversion.
-int BinaryParser::convertTwosComplementToDecimal(string str) {
-  char sign = str[0]; // first bit of this format
-
-  // if the value is negative, we swap the bits
-  if (sign == '1') {
-    for (int i = 0; i < str.length(); i++) {
-      if (str[i] == '0')
-        str[i] = '1';
-      else 
-        str[i] = '0';
-    }
-    // This function converts a binary string to decimal
-    // Add one and return the negative
-    int decimal = stoi(str, nullptr, 2) + 1;
-    return -decimal;
+// Registers are written by number, e.g. "$8"
+static char *writeRegister(char *out, int reg) {
+  *out++ = '$';
+  return writeDecimal(out, reg);
+}
+
+// Writes one operand of instruction i, as described by kind
+static char *writeOperand(char *out, OperandKind kind, const Instruction& i) {
+  switch (kind) {
+    case OPERAND_RS:
+      return writeRegister(out, i.getRSNum());
+    case OPERAND_RT:
+      return writeRegister(out, i.getRTNum());
+    case OPERAND_RD:
+      return writeRegister(out, i.getRDNum());
+    case OPERAND_SHAMT:
+    case OPERAND_IMM:
+    case OPERAND_UIMM:
+      return writeDecimal(out, i.getImmediate());
+
+    // Labels are word offsets or addresses, printed as hexadecimal bytes
+    case OPERAND_BRANCH:
+    case OPERAND_TARGET:
+      out = writeText(out, "0x");
+      return writeHex(out, (uint32_t)i.getImmediate() * 4);
+
+    // Memory operands are written "imm(rs) " (with the trailing space the
+    // format has always had)
+    case OPERAND_MEMORY:
+      out = writeDecimal(out, i.getImmediate());
+      *out++ = '(';
+      out = writeRegister(out, i.getRSNum());
+      return writeText(out, ") ");
+
+    case OPERAND_NONE:
+      break;
+  }
+  return out;
+}
+
+// This function writes the assembly code of a single MIPS instruction
+// into out (at least maxAssemblyLength bytes) and returns its length
+int BinaryParser::formatAssembly(const Instruction& i, char *out) {
+  STATS_PHASE(PHASE_FORMAT);
+  Opcode opcode = i.getOpcode();
+  if (opcode == UNDEFINED)
+    return 0;
+
+  // The name, a tab, and the operands in the order isaSpec gives them,
+  // separated by ", "
+  const OpcodeSpec& spec = opcodes.getSpec(opcode);
+  char *end = writeText(out, spec.name);
+  for (int n = 0; n < maxOperands && spec.operands[n] != OPERAND_NONE; n++) {
+    end = writeText(end, n == 0 ? "\t" : ", ");
+    end = writeOperand(end, spec.operands[n], i);
   }
-  // if positive, we only need to convert to binary
-  int decimal = stoi(str, nullptr, 2);
-  return decimal;
+  return end - out;
 }
 
 // Iterator that returns the next Instruction in the list of Instructions
 Instruction BinaryParser::getNextInstruction() {
+  // When streaming, decode the next batch once the current one is used up
+  if (myInput != NULL && myIndex >= (int)(myInstructions.size()) && myFormatCorrect)
+    readInstructions(*myInput, myBatchSize);
+
   if (myIndex < (int)(myInstructions.size())) {
     myIndex++;
     return myInstructions[myIndex - 1];
   }
   
+  Instruction i;
+  return i;
+}
+
+// Returns the Instruction at position index of the list, or an UNDEFINED
+// Instruction if there is none
+Instruction BinaryParser::getInstruction(size_t index) {
+  if (index < myInstructions.size())
+    return myInstructions[index];
+
   Instruction i;
   return i;
 }
\ No newline at end of file
@@ -6,13 +6,46 @@
 #include "Instruction.h"
 #include "RegisterTable.h"
 #include "OpcodeTable.h"
+#include "MappedFile.h"
+#include "LinePacker.h"
+#include "ThreadPool.h"
+#include "AssemblyCache.h"
+#include "DecodeStats.h"
 #include <math.h>
 #include <vector>
 #include <sstream>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string_view>
+#include <atomic>
 
 using namespace std;
 
+// Supported layouts of the input file
+enum InputFormat {
+  TEXT_INPUT,        // one line of 32 '0'/'1' characters per instruction
+  RAW_BIG_ENDIAN,    // raw 4 byte words, most significant byte first
+  RAW_LITTLE_ENDIAN  // raw 4 byte words, least significant byte first
+};
+
+// Why a line of the input could not be decoded
+enum DecodeErrorReason {
+  BAD_LENGTH,        // not 32 characters long, or a trailing partial raw word
+  BAD_CHARACTER,     // a character other than '0' or '1'
+  UNKNOWN_OPCODE,    // the opcode field is not a supported instruction
+  UNKNOWN_FUNCT,     // an opcode 0 (SPECIAL) word with an unsupported funct field
+  UNKNOWN_REGIMM     // an opcode 1 (REGIMM) word with an unsupported rt field
+};
+
+// A line of the input that could not be decoded
+struct DecodeError {
+  size_t line;               // line (or raw word) number, counting from 1
+  size_t offset;             // byte offset of the line in the file
+  size_t column;             // for BAD_CHARACTER, the offending character's
+                             // position in the line, counting from 1
+  DecodeErrorReason reason;
+};
+
 /* This class reads in a MIPS assembly file and checks its syntax.  If
  * the file is syntactically correct, this class will retain a list 
  * of Instructions (one for each instruction from the file).  This
@@ -22,81 +55,145 @@ class BinaryParser {
 
   public:
 
+    // Creates a parser holding no Instructions, for decoding words one at a
+    // time with checkInstSyntax() and decodeWord()
+    BinaryParser();
+
     // Specify a text file containing 32b encodings. Function
     // checks syntactic correctness of file and creates a list of Instructions.
-    BinaryParser(string filename);
+    // The file is memory mapped and its lines are decoded in place.  If format
+    // is one of the raw formats, the file instead holds 4 byte binary words.
+    // With numThreads > 1 the file is split at line boundaries into chunks
+    // that are decoded in parallel; the Instructions keep their file order.
+    // Normally decoding stops at the first bad line and nothing is kept.
+    // With collectErrors the whole file is validated instead: every bad line
+    // is recorded in getErrors() and every good one is still decoded.
+    BinaryParser(string filename, InputFormat format = TEXT_INPUT, int numThreads = 1,
+                 bool collectErrors = false);
+
+    // Streaming mode: instructions are read from the given stream and decoded
+    // batchSize lines at a time as getNextInstruction() asks for them, so
+    // memory use does not depend on the length of the input. A batchSize of
+    // 0 reads the whole stream up front like the filename constructor.
+    BinaryParser(istream& in, int batchSize, InputFormat format = TEXT_INPUT);
+
+    // The number of lines decoded at a time in streaming mode
+    const static int defaultBatchSize = 4096;
 
     // Returns true if the file specified was syntactically correct.  Otherwise,
-    // returns false.
+    // returns false.  In streaming mode this only covers the lines read so far.
     bool isFormatCorrect() { return myFormatCorrect; };
 
-    // Iterator that returns the next Instruction in the list of Instructions.
-    Instruction getNextInstruction();
+    // Returns the bad lines of the file, in file order, when it was parsed
+    // with collectErrors
+    const vector<DecodeError>& getErrors() { return myErrors; };
 
-  private:
+    // Returns a short description of reason
+    static string getErrorDescription(DecodeErrorReason reason);
 
-    vector<Instruction> myInstructions;      // list of Instructions
-    int myIndex;                             // iterator index
-    bool myFormatCorrect;
+    // This function works out why a line that failed to decode is bad.  Only
+    // the reason and column of the result are filled in.
+    static DecodeError diagnoseLine(string_view line);
 
-    const static int encodedInstLength = 32; // The length of an encoded MIPS instruction
-    const static int opcodeLength = 6;       // Length of an opcode is 6 bits
-    const static int registerLength = 5;     // Length of encoded register is 5 bits
-    const static int funcFieldLocation = 26; // The encoded function field begins at bit 26           
+    // This function works out why a word that failed to decode is bad
+    static DecodeErrorReason diagnoseWord(uint32_t word);
 
-    RegisterTable registers;                 // encodings for registers
-    OpcodeTable opcodes;                     // encodings of opcodes
+    // This function checks the syntax of a binary MIPS instruction and, if it
+    // is correct, packs its 32 characters into word (most significant bit first).
+    bool checkInstSyntax(string_view inst, uint32_t& word);
 
-    // This function checks the syntax of a binary MIPS instruction
-    bool checkInstSyntax(string inst);
+    // This function assembles a 32 bit word from 4 raw input bytes in the
+    // byte order of format (RAW_BIG_ENDIAN or RAW_LITTLE_ENDIAN)
+    static uint32_t unpackRawWord(const char *bytes, InputFormat format);
 
-    // This function receives a 32 bit line representing a MIPS instruction,
-    // and returns the opcode field of that instruction
-    string getOpcodeField(string line);
+    // This function stores word as 4 raw bytes in the byte order of format,
+    // the reverse of unpackRawWord()
+    static void packRawWord(uint32_t word, InputFormat format, char *bytes);
 
-    // This function receives a 32 bit line representing a MIPS instruction
-    // and returns the last 6 bits, where the function field of an RTYPE 
-    // command is located.
-    string getFuncField(string line);
+    // This function decodes a single 32 bit instruction word into i.
+    // Returns false if the word is not a supported instruction.
+    bool decodeWord(uint32_t word, Instruction& i);
 
-    // This function receives a 32b line representing a MIPS instruction,
-    // and returns the instruction without the 6b opcode.
-    string getLineNoOpcode(string line);
+    // Returns the MIPS assembly text of an Instruction returned by
+    // getNextInstruction().  The text is formatted on first use and kept in
+    // a cache keyed by the instruction word, so repeated words are only
+    // formatted once.  The view is valid until the next call.
+    string_view getAssembly(const Instruction& i);
 
-    // This function returns a string representing the assembly code of
-    // a single MIPS instruction
-    string createAssemblyCode(Instruction i);
+    // Writes the MIPS assembly text of i into out, which must hold at least
+    // maxAssemblyLength bytes, and returns its length.  Unlike getAssembly()
+    // this does not use the cache and may be called from several threads.
+    int formatAssembly(const Instruction& i, char *out);
 
-    // This function separates an RType instruction into the fields needed to 
-    // print the assembly representation.
-    bool decodeRType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode);
+    // Longest assembly text formatAssembly() can produce
+    const static int maxAssemblyLength = 64;
 
-    // This function separates an IType instruction into the fields needed to 
-    // print the assembly representation.
-    bool decodeIType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode);
+    // Returns the cache used by getAssembly(), for its hit/miss counters
+    AssemblyCache& getAssemblyCache() { return myAssemblyCache; };
+
+    // Iterator that returns the next Instruction in the list of Instructions.
+    // In streaming mode, the next batch is decoded when the current one runs out.
+    Instruction getNextInstruction();
 
-    // This function separates an JType instruction into the fields needed to 
-    // print the assembly representation.
-    bool decodeJType(Instruction& i, Opcode opcode, string& op_name, string& lineWithoutOpcode);
+    // Returns the number of Instructions currently held.  In streaming
+    // mode this is the size of the current batch.
+    size_t getNumInstructions() { return myInstructions.size(); };
 
-    // This function uses the RType fields to set the values of an instruction data type
-    string writeRTypeDecoded(Instruction i);
+    // Returns the Instruction at position index of the list, or an UNDEFINED
+    // Instruction if there is none
+    Instruction getInstruction(size_t index);
 
-    // This function uses the IType fields to set the values of an instruction data type
-    string writeITypeDecoded(Instruction i);
+    // Returns the list of Instructions currently held
+    const vector<Instruction>& getInstructions() { return myInstructions; };
 
-    // This function uses the JType fields to set the values of an instruction data type
-    string writeJTypeDecoded(Instruction i);
+  private:
 
-    // This function converts a binary register value into a decimal string
-    string convertRegisterToAssembly(string& reg, int start, int finish);
+    vector<Instruction> myInstructions;      // list of Instructions
+    int myIndex;                             // iterator index
+    bool myFormatCorrect;
+    istream *myInput;                        // input stream when streaming, else NULL
+    int myBatchSize;                         // lines decoded per batch when streaming
+    InputFormat myFormat;                    // layout of the input
+    vector<DecodeError> myErrors;            // bad lines, when collecting errors
 
-    // This function converts a binary string in two's complement
-    // into a decimal value (as a string). Used in IType conversion.
-    int convertTwosComplementToDecimal(string str);
+    const static int encodedInstLength = 32; // The length of an encoded MIPS instruction
+    const static int rawWordLength = 4;      // Bytes per instruction in the raw formats
 
-    // Returns true if character is a digit
-    bool isOneOrZero(char c)     { return (c == '0' || c == '1'); };
+    OpcodeTable opcodes;                     // encodings of opcodes
+    LinePacker packer;                       // validates and packs text lines
+
+    AssemblyCache myAssemblyCache;           // formatted text of recent words
+    char myUncachedAssembly[maxAssemblyLength]; // text formatted on a cache miss
+
+    // Number of chunks per thread when decoding in parallel, so that
+    // threads which finish early can pick up more of the work
+    const static int chunksPerThread = 4;
+
+    // Chunks are never split smaller than this many bytes
+    const static size_t minChunkSize = 1 << 16;
+
+    // This function decodes the lines (or raw words) in the byte range
+    // [start, end) of in, appending them to out.  Returns false as soon as a
+    // bad line is found, or if cancelled is set by another thread.  If errors
+    // is not NULL, bad lines are appended to it instead and decoding goes on;
+    // their line numbers count from 0 at start.
+    bool decodeRange(MappedFile& in, size_t start, size_t end, vector<Instruction>& out,
+                     vector<DecodeError> *errors, atomic<bool> *cancelled);
+
+    // This function splits in into chunks and decodes them on numThreads
+    // threads, storing the Instructions in file order.  Returns false, with
+    // the remaining chunks cancelled, as soon as any chunk has a bad line.
+    // With collectErrors no chunk is cancelled, and the bad lines of every
+    // chunk are gathered into myErrors.
+    bool decodeParallel(MappedFile& in, int numThreads, bool collectErrors);
+
+    // This function reads and decodes up to maxCount lines (all remaining
+    // lines if maxCount is 0) from in, replacing the current list of Instructions.
+    void readInstructions(istream& in, int maxCount);
+
+    // This function checks and decodes a single line of the input into i.
+    // Returns false if the line is not a valid encoded instruction.
+    bool decodeLine(string_view line, Instruction& i);
 
 };
 
@@ -0,0 +1,90 @@
+#include "CorpusGenerator.h"
+
+// Creates a generator with a uniform opcode mix
+CorpusGenerator::CorpusGenerator(uint64_t seed) {
+  myState = seed;
+  myTotalWeight = 0;
+
+  for (int o = 0; o < (int)UNDEFINED; o++) {
+    myWeights[o] = 1;
+    myTotalWeight++;
+  }
+}
+
+// Sets the relative weight of the named opcode (e.g. "add").  A weight of 0
+// removes it from the mix.  Returns false if the name is not an opcode.
+bool CorpusGenerator::setWeight(string opcodeName, int weight) {
+  if (weight < 0)
+    return false;
+
+  Opcode o = opcodes.getOpcode(string_view(opcodeName));
+  if (o == UNDEFINED)
+    return false;
+
+  myTotalWeight += weight - myWeights[o];
+  myWeights[o] = weight;
+  return true;
+}
+
+// Sets the mix from a list such as "add=3,lb=1,j=1".  Opcodes not listed
+// get weight 0.  Returns false if the list is malformed.
+bool CorpusGenerator::setMix(string mix) {
+  for (int o = 0; o < (int)UNDEFINED; o++)
+    myWeights[o] = 0;
+  myTotalWeight = 0;
+
+  size_t pos = 0;
+  while (pos < mix.length()) {
+    size_t comma = mix.find(',', pos);
+    if (comma == string::npos)
+      comma = mix.length();
+
+    string item = mix.substr(pos, comma - pos);
+    size_t equals = item.find('=');
+    int weight = 1;
+    if (equals != string::npos) {
+      weight = atoi(item.c_str() + equals + 1);
+      item = item.substr(0, equals);
+    }
+    if (!setWeight(item, weight))
+      return false;
+
+    pos = comma + 1;
+  }
+  return myTotalWeight > 0;
+}
+
+// Returns the next 64 random bits
+uint64_t CorpusGenerator::nextRandom() {
+  uint64_t z = (myState += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Returns an Opcode drawn from the weighted mix
+Opcode CorpusGenerator::nextOpcode() {
+  int pick = nextRandom() % myTotalWeight;
+  for (int o = 0; o < (int)UNDEFINED; o++) {
+    pick -= myWeights[o];
+    if (pick < 0)
+      return (Opcode)o;
+  }
+  return (Opcode)0;
+}
+
+// Returns the next instruction word: the bits identifying a random
+// instruction, with random values in the fields of its operands
+uint32_t CorpusGenerator::nextWord() {
+  const OpcodeSpec& spec = opcodes.getSpec(nextOpcode());
+  uint32_t bits = (uint32_t)nextRandom();
+
+  return spec.fixedBits() | (bits & spec.operandBits());
+}
+
+// Appends count instruction words to words
+void CorpusGenerator::generate(size_t count, vector<uint32_t>& words) {
+  words.reserve(words.size() + count);
+  for (size_t n = 0; n < count; n++)
+    words.push_back(nextWord());
+}
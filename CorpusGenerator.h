@@ -0,0 +1,54 @@
+#ifndef __CORPUSGENERATOR_H__
+#define __CORPUSGENERATOR_H__
+
+#include "OpcodeTable.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class produces deterministic streams of valid MIPS instruction words
+ * for benchmarking.  Each word's opcode is drawn from a weighted mix over
+ * the supported Opcodes (uniform by default); the register, shift amount,
+ * immediate and address fields that the opcode uses are filled with random
+ * values and the unused fields are left zero.  The same seed and mix always
+ * produce the same words, on any platform.
+ */
+class CorpusGenerator {
+
+ public:
+
+  // Creates a generator with a uniform opcode mix
+  CorpusGenerator(uint64_t seed = 1);
+
+  // Sets the relative weight of the named opcode (e.g. "add").  A weight of 0
+  // removes it from the mix.  Returns false if the name is not an opcode.
+  bool setWeight(string opcodeName, int weight);
+
+  // Sets the mix from a list such as "add=3,lb=1,j=1".  Opcodes not listed
+  // get weight 0.  Returns false if the list is malformed.
+  bool setMix(string mix);
+
+  // Returns the next instruction word
+  uint32_t nextWord();
+
+  // Appends count instruction words to words
+  void generate(size_t count, vector<uint32_t>& words);
+
+ private:
+
+  OpcodeTable opcodes;
+  int myWeights[UNDEFINED];
+  int myTotalWeight;
+  uint64_t myState;                 // splitmix64 state
+
+  // Returns the next 64 random bits
+  uint64_t nextRandom();
+
+  // Returns an Opcode drawn from the weighted mix
+  Opcode nextOpcode();
+
+};
+
+#endif
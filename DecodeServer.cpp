@@ -0,0 +1,365 @@
+#include "DecodeServer.h"
+#include "BinaryParser.h"
+#include "OutputWriter.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Longest request header line accepted
+const static size_t maxHeaderLength = 4096;
+
+/* This class reads the requests of a session from a file descriptor
+ * through a buffer: header lines, and payloads of a known size.
+ */
+class FrameReader {
+
+ public:
+
+  // Creates a reader for fd
+  FrameReader(int fd) : myFd(fd), myBuffer(bufferSize), myStart(0), myEnd(0),
+                        myLineTooLong(false) {};
+
+  // Reads the next line, without its newline, into line.  Returns false at
+  // the end of the input, or if the line is longer than maxHeaderLength
+  // (see isLineTooLong()).
+  bool readLine(string& line) {
+    line.clear();
+    while (true) {
+      char *start = myBuffer.data() + myStart;
+      char *newline = (char *)memchr(start, '\n', myEnd - myStart);
+      if (newline != NULL) {
+        line.append(start, newline - start);
+        myStart += newline - start + 1;
+        myLineTooLong = line.length() > maxHeaderLength;
+        return !myLineTooLong;
+      }
+
+      line.append(start, myEnd - myStart);
+      myStart = myEnd;
+      myLineTooLong = line.length() > maxHeaderLength;
+      if (myLineTooLong || !fill())
+        return false;
+    }
+  }
+
+  // Returns true if the last readLine() failed because the line was too long
+  bool isLineTooLong()  { return myLineTooLong; };
+
+  // Reads exactly size bytes into out, or discards them if out is NULL.
+  // Returns false if the input ends first.
+  bool read(char *out, size_t size) {
+    while (size > 0) {
+      if (myStart == myEnd && !fill())
+        return false;
+      size_t n = myEnd - myStart < size ? myEnd - myStart : size;
+      if (out != NULL) {
+        memcpy(out, myBuffer.data() + myStart, n);
+        out += n;
+      }
+      myStart += n;
+      size -= n;
+    }
+    return true;
+  }
+
+ private:
+
+  const static size_t bufferSize = 1 << 16;
+
+  int myFd;
+  vector<char> myBuffer;
+  size_t myStart;           // first unread byte of myBuffer
+  size_t myEnd;             // end of the bytes read into myBuffer
+  bool myLineTooLong;
+
+  // Refills the empty buffer.  Returns false at the end of the input.
+  bool fill() {
+    myStart = myEnd = 0;
+    while (true) {
+      ssize_t n = ::read(myFd, myBuffer.data(), myBuffer.size());
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      myEnd = n;
+      return true;
+    }
+  }
+
+};
+
+// Describes the first bad line of a file parsed with collectErrors
+static string describeError(const DecodeError& error) {
+  ostringstream text;
+  text << "line " << error.line << ", byte " << error.offset << ": "
+       << BinaryParser::getErrorDescription(error.reason);
+  return text.str();
+}
+
+// Decodes the named file in format into out.  Returns false, setting error,
+// if it cannot be read or has a bad line.
+static bool decodeFile(BinaryParser& formatter, string path, InputFormat format,
+                       OutputWriter& out, uint64_t& count, string& error) {
+  BinaryParser parser(path, format, 1, true);
+  if (!parser.isFormatCorrect()) {
+    if (parser.getErrors().empty())
+      error = "cannot read " + path;
+    else
+      error = describeError(parser.getErrors()[0]);
+    return false;
+  }
+
+  count = parser.getNumInstructions();
+  for (size_t n = 0; n < count; n++) {
+    Instruction i = parser.getInstruction(n);
+    out.appendEncodedLine(i.getWord(), formatter.getAssembly(i));
+  }
+  return true;
+}
+
+// Decodes size bytes of big-endian words at data into out.  Returns false,
+// setting error, at the first word that is not a supported instruction.
+static bool decodeWords(BinaryParser& formatter, const char *data, size_t size,
+                        OutputWriter& out, uint64_t& count, string& error) {
+  const char *b = data;
+  Instruction i;
+
+  for (count = 0; count < size / 4; count++, b += 4) {
+    uint32_t word = BinaryParser::unpackRawWord(b, RAW_BIG_ENDIAN);
+    if (!formatter.decodeWord(word, i)) {
+      error = "word " + to_string(count + 1) + ": " +
+              BinaryParser::getErrorDescription(BinaryParser::diagnoseWord(word));
+      return false;
+    }
+    out.appendEncodedLine(i.getWord(), formatter.getAssembly(i));
+  }
+  return true;
+}
+
+// Decodes the lines of text encodings in the size bytes at data into out.
+// Returns false, setting error, at the first bad line.
+static bool decodeText(BinaryParser& formatter, const char *data, size_t size,
+                       OutputWriter& out, uint64_t& count, string& error) {
+  const char *end = data + size;
+  uint32_t word;
+  Instruction i;
+
+  for (count = 0; data < end; count++) {
+    const char *newline = (const char *)memchr(data, '\n', end - data);
+    string_view line(data, (newline != NULL ? newline : end) - data);
+    data = (newline != NULL ? newline + 1 : end);
+
+    if (!formatter.checkInstSyntax(line, word) || !formatter.decodeWord(word, i)) {
+      error = "line " + to_string(count + 1) + ": " +
+              BinaryParser::getErrorDescription(BinaryParser::diagnoseLine(line).reason);
+      return false;
+    }
+    out.appendEncodedLine(i.getWord(), formatter.getAssembly(i));
+  }
+  return true;
+}
+
+// Splits the first word off text, along with the space after it
+static string_view nextWord(string_view& text) {
+  size_t space = text.find(' ');
+  string_view word = text.substr(0, space);
+  text.remove_prefix(space == string_view::npos ? text.length() : space + 1);
+  return word;
+}
+
+// Parses a whole decimal number no larger than limit
+static bool parseCount(string_view text, uint64_t limit, uint64_t& value) {
+  if (text.empty() || text.length() > 19)
+    return false;
+  value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9')
+      return false;
+    value = value * 10 + (c - '0');
+  }
+  return value <= limit;
+}
+
+// Creates a server that handles up to numThreads socket connections at once
+DecodeServer::DecodeServer(int numThreads, uint64_t maxPayload) : myShutdown(false) {
+  myNumThreads = numThreads < 1 ? 1 : numThreads;
+  myMaxPayload = maxPayload;
+  myListenFd = -1;
+  myErrors = 0;
+}
+
+// Serves a single session that reads requests from inFd and writes
+// responses to outFd, until QUIT, SHUTDOWN or the end of the input
+void DecodeServer::serveStream(int inFd, int outFd) {
+  serveSession(inFd, outFd);
+}
+
+// Listens on a Unix domain socket at path, serving each connection as a
+// session, until a session asks for SHUTDOWN; then waits for the open
+// sessions to end and removes the socket.  Returns false, with the reason
+// on stderr, if the socket could not be created.
+bool DecodeServer::serveSocket(string path) {
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.length() >= sizeof(address.sun_path)) {
+    cerr << "Socket path is too long: " << path << endl;
+    return false;
+  }
+  memcpy(address.sun_path, path.data(), path.length());
+
+  // A socket left behind by an earlier server is replaced; anything else
+  // at path is left alone and bind() fails
+  struct stat status;
+  if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+    unlink(path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 64) < 0) {
+    cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+  myListenFd = fd;
+
+  {
+    ThreadPool pool(myNumThreads);
+    while (!myShutdown.load()) {
+      int connection = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+      if (connection < 0) {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        break;
+      }
+      pool.submit([this, connection]() {
+        serveSession(connection, connection);
+        close(connection);
+      });
+    }
+    pool.wait();
+  }
+
+  myListenFd = -1;
+  close(fd);
+  unlink(path.c_str());
+  return true;
+}
+
+// Prints the latencies of the requests served so far
+void DecodeServer::report(ostream& out) {
+  lock_guard<mutex> guard(myLock);
+  myLatencies.report(out);
+  out << myErrors << " requests failed" << endl;
+}
+
+// This function records the latency of one request
+void DecodeServer::recordRequest(uint64_t nanoseconds, bool failed) {
+  lock_guard<mutex> guard(myLock);
+  myLatencies.record(nanoseconds);
+  if (failed)
+    myErrors++;
+}
+
+// This function serves requests on one session until it ends
+void DecodeServer::serveSession(int inFd, int outFd) {
+  FrameReader in(inFd);
+  OutputWriter out(outFd);
+  OutputWriter payload(-1);
+  BinaryParser formatter;       // its assembly cache stays warm across requests
+  vector<char> input;
+  string header, error;
+
+  while (true) {
+    bool complete = in.readLine(header);
+    if (!complete && !in.isLineTooLong())
+      break;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string_view arguments(header);
+    string_view command = nextWord(arguments);
+    uint64_t count = 0, size = 0;
+    bool ok = false;
+    bool framingLost = false;     // the unread payload would be taken for headers
+
+    payload.clear();
+    error.clear();
+
+    if (!complete) {
+      error = "header too long";
+      framingLost = true;
+    }
+    else if (command == "QUIT")
+      break;
+    else if (command == "SHUTDOWN") {
+      myShutdown.store(true);
+      if (myListenFd >= 0)
+        shutdown(myListenFd, SHUT_RDWR);  // wakes the accept() loop
+      break;
+    }
+    else if (command == "FILE" && !arguments.empty())
+      ok = decodeFile(formatter, string(arguments), TEXT_INPUT, payload, count, error);
+    else if (command == "RAW") {
+      string_view order = nextWord(arguments);
+      if ((order == "big" || order == "little") && !arguments.empty())
+        ok = decodeFile(formatter, string(arguments),
+                        order == "big" ? RAW_BIG_ENDIAN : RAW_LITTLE_ENDIAN, payload, count, error);
+      else
+        error = "usage: RAW big|little <path>";
+    }
+    else if (command == "WORDS" || command == "TEXT") {
+      uint64_t limit = (command == "WORDS") ? myMaxPayload / 4 : myMaxPayload;
+      if (!parseCount(arguments, limit, size)) {
+        error = "bad payload size";
+        framingLost = true;
+      }
+      else {
+        if (command == "WORDS")
+          size *= 4;
+        input.resize(size);
+        if (!in.read(input.data(), size))
+          break;
+        if (command == "WORDS")
+          ok = decodeWords(formatter, input.data(), size, payload, count, error);
+        else
+          ok = decodeText(formatter, input.data(), size, payload, count, error);
+      }
+    }
+    else if (command == "STATS") {
+      ostringstream text;
+      report(text);
+      payload.append(text.str());
+      ok = true;
+    }
+    else
+      error = "unknown request";
+
+    if (ok) {
+      out.append("OK ");
+      out.appendDecimal(count);
+      out.append(' ');
+      out.appendDecimal(payload.getContents().length());
+      out.endLine();
+      out.append(payload.getContents());
+    }
+    else {
+      out.append("ERROR ");
+      out.append(error);
+      out.endLine();
+    }
+    if (!out.flush())
+      break;
+
+    recordRequest(chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start).count(), !ok);
+    if (framingLost)
+      break;
+  }
+}
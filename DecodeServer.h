@@ -0,0 +1,81 @@
+#ifndef __DECODESERVER_H__
+#define __DECODESERVER_H__
+
+#include "LatencyHistogram.h"
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class is a long running decoder that answers requests over a framed
+ * protocol, either on a pair of file descriptors (stdin and stdout) or on
+ * the connections of a Unix domain socket.  Each session keeps its parser,
+ * assembly cache and buffers from one request to the next, so a small
+ * request costs only its decoding, not a process start.
+ *
+ * A request is one header line, followed for WORDS and TEXT by a payload
+ * of exactly the number of bytes the header gives:
+ *
+ *   FILE <path>               decode a file of text encodings
+ *   RAW big|little <path>     decode a file of raw 4 byte words
+ *   WORDS <count>             decode count big-endian words that follow
+ *   TEXT <bytes>              decode the lines of text encodings that follow
+ *   STATS                     report the request latencies
+ *   QUIT                      end the session
+ *   SHUTDOWN                  end the session and stop the server
+ *
+ * Every request except QUIT and SHUTDOWN gets one response.  A successful
+ * one is the line "OK <instructions> <bytes>" followed by bytes of output:
+ * one line per instruction, as Binary prints it, or the latency report for
+ * STATS.  A failed one is the single line "ERROR <reason>".  If the size
+ * of a WORDS or TEXT payload cannot be parsed or is over the server's
+ * limit, or a header is longer than 4096 bytes, the rest of the request
+ * cannot be told apart from the next header, so the session ends after the
+ * ERROR.  The latency of a request runs from reading its header to writing
+ * its response.
+ */
+class DecodeServer {
+
+ public:
+
+  // Creates a server that handles up to numThreads socket connections at
+  // once, and accepts WORDS and TEXT payloads of up to maxPayload bytes
+  DecodeServer(int numThreads = 1, uint64_t maxPayload = defaultMaxPayload);
+
+  // Serves a single session that reads requests from inFd and writes
+  // responses to outFd, until QUIT, SHUTDOWN or the end of the input
+  void serveStream(int inFd, int outFd);
+
+  // Listens on a Unix domain socket at path, serving each connection as a
+  // session, until a session asks for SHUTDOWN; then waits for the open
+  // sessions to end and removes the socket.  Returns false, with the reason
+  // on stderr, if the socket could not be created.
+  bool serveSocket(string path);
+
+  // Prints the latencies of the requests served so far
+  void report(ostream& out);
+
+  const static uint64_t defaultMaxPayload = 16 << 20;
+
+ private:
+
+  int myNumThreads;
+  atomic<bool> myShutdown;          // set by a SHUTDOWN request
+  int myListenFd;                   // listening socket, or -1
+  uint64_t myMaxPayload;            // largest WORDS or TEXT payload accepted
+
+  mutex myLock;                     // guards the counters below
+  LatencyHistogram myLatencies;
+  uint64_t myErrors;                // requests answered with ERROR
+
+  // This function records the latency of one request
+  void recordRequest(uint64_t nanoseconds, bool failed);
+
+  // This function serves requests on one session until it ends
+  void serveSession(int inFd, int outFd);
+
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "DecodeStats.h"
+#include <chrono>
+#include <mutex>
+#include <iomanip>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+bool DecodeStats::enabled = false;
+
+// The counters kept by each thread and by the merged total
+struct StatsCounters {
+  uint64_t phaseTicks[NUM_PHASES];
+  uint64_t phaseCalls[NUM_PHASES];
+  uint64_t opcodes[UNDEFINED];
+  uint64_t bytesRead;
+  uint64_t bytesWritten;
+
+  // Adds another set of counters into this one
+  void add(const StatsCounters& other) {
+    for (int p = 0; p < NUM_PHASES; p++) {
+      phaseTicks[p] += other.phaseTicks[p];
+      phaseCalls[p] += other.phaseCalls[p];
+    }
+    for (int o = 0; o < (int)UNDEFINED; o++)
+      opcodes[o] += other.opcodes[o];
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+  }
+};
+
+// Counters of threads that have exited, and the lock that guards them
+static StatsCounters mergedCounters;
+static mutex mergedLock;
+
+// True while the calling thread's threadCounters exist
+static thread_local bool threadCountersAlive = false;
+
+// Each thread's own counters, merged into mergedCounters when it exits
+struct ThreadCounters : StatsCounters {
+  ThreadCounters() {
+    StatsCounters empty = {};
+    *(StatsCounters *)this = empty;
+    threadCountersAlive = true;
+  }
+  ~ThreadCounters() {
+    unique_lock<mutex> lock(mergedLock);
+    mergedCounters.add(*this);
+    threadCountersAlive = false;
+  }
+};
+static thread_local ThreadCounters threadCounters;
+
+// Reference points for converting ticks to seconds
+static uint64_t startTicks;
+static chrono::steady_clock::time_point startTime;
+static bool reportJson;
+
+// Returns a timestamp for phase timing in a fast, CPU-specific unit
+uint64_t DecodeStats::readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return chrono::duration_cast<chrono::nanoseconds>(
+           chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Starts collecting.  The report is printed to stderr (as JSON if json is
+// true) when the program exits.
+void DecodeStats::enable(bool json) {
+  if (enabled)
+    return;
+
+  reportJson = json;
+  startTicks = readTicks();
+  startTime = chrono::steady_clock::now();
+  enabled = true;
+  atexit(reportAtExit);
+}
+
+// Counts one decoded instruction with the given Opcode
+void DecodeStats::countOpcode(Opcode o) {
+  if (o >= 0 && o < UNDEFINED)
+    threadCounters.opcodes[o]++;
+}
+
+// Adds to the byte counters
+void DecodeStats::addBytesRead(uint64_t bytes) {
+  threadCounters.bytesRead += bytes;
+}
+
+void DecodeStats::addBytesWritten(uint64_t bytes) {
+  threadCounters.bytesWritten += bytes;
+}
+
+// Adds ticks (see readTicks()) and one call to a phase
+void DecodeStats::addPhaseTime(StatsPhase phase, uint64_t ticks) {
+  threadCounters.phaseTicks[phase] += ticks;
+  threadCounters.phaseCalls[phase]++;
+}
+
+// Prints the report to stderr; registered with atexit by enable()
+void DecodeStats::reportAtExit() {
+  report(cerr, reportJson);
+}
+
+// Prints the statistics collected so far
+void DecodeStats::report(ostream& out, bool json) {
+  static const char *phaseNames[NUM_PHASES] = {
+    "read", "validate", "lookup", "decode", "format", "write"
+  };
+  static const char *typeNames[3] = { "RTYPE", "ITYPE", "JTYPE" };
+
+  // Totals of the exited threads plus the calling thread, whose counters
+  // have already been merged if it is exiting
+  StatsCounters total;
+  {
+    unique_lock<mutex> lock(mergedLock);
+    total = mergedCounters;
+  }
+  if (threadCountersAlive)
+    total.add(threadCounters);
+
+  double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+  uint64_t elapsedTicks = readTicks() - startTicks;
+  double secondsPerTick = (elapsedTicks > 0) ? wallSeconds / elapsedTicks : 0;
+
+  OpcodeTable opcodes;
+  uint64_t instructions = 0;
+  uint64_t types[3] = { 0, 0, 0 };
+  for (int o = 0; o < (int)UNDEFINED; o++) {
+    instructions += total.opcodes[o];
+    types[opcodes.getInstType((Opcode)o)] += total.opcodes[o];
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  long peakRssKb = usage.ru_maxrss;
+
+  if (json) {
+    out << "{\"wall_seconds\":" << wallSeconds << ",\"phases\":{";
+    for (int p = 0; p < NUM_PHASES; p++)
+      out << (p ? "," : "") << "\"" << phaseNames[p] << "\":{\"seconds\":"
+          << total.phaseTicks[p] * secondsPerTick << ",\"calls\":" << total.phaseCalls[p] << "}";
+    out << "},\"instructions\":" << instructions << ",\"inst_types\":{";
+    for (int t = 0; t < 3; t++)
+      out << (t ? "," : "") << "\"" << typeNames[t] << "\":" << types[t];
+    out << "},\"opcodes\":{";
+    for (int o = 0; o < (int)UNDEFINED; o++)
+      out << (o ? "," : "") << "\"" << opcodes.getOpcodeName((Opcode)o) << "\":" << total.opcodes[o];
+    out << "},\"bytes_read\":" << total.bytesRead << ",\"bytes_written\":" << total.bytesWritten
+        << ",\"peak_rss_kb\":" << peakRssKb << "}" << endl;
+    return;
+  }
+
+  out << "Wall time: " << fixed << setprecision(6) << wallSeconds << " s" << endl;
+  out << left << setw(10) << "Phase" << right << setw(14) << "seconds"
+      << setw(14) << "calls" << setw(12) << "ns/call" << endl;
+  for (int p = 0; p < NUM_PHASES; p++) {
+    double seconds = total.phaseTicks[p] * secondsPerTick;
+    out << left << setw(10) << phaseNames[p] << right << setw(14) << setprecision(6) << seconds
+        << setw(14) << total.phaseCalls[p] << setw(12) << setprecision(1)
+        << (total.phaseCalls[p] ? seconds * 1e9 / total.phaseCalls[p] : 0.0) << endl;
+  }
+  out << "Instructions: " << instructions;
+  for (int t = 0; t < 3; t++)
+    out << (t ? ", " : " (") << typeNames[t] << " " << types[t];
+  out << ")" << endl << "Opcodes:";
+  for (int o = 0; o < (int)UNDEFINED; o++)
+    out << " " << opcodes.getOpcodeName((Opcode)o) << " " << total.opcodes[o];
+  out << endl << "Bytes read: " << total.bytesRead << ", written: " << total.bytesWritten << endl;
+  out << "Peak RSS: " << peakRssKb << " KiB" << endl;
+}
@@ -0,0 +1,91 @@
+#ifndef __DECODESTATS_H__
+#define __DECODESTATS_H__
+
+#include "OpcodeTable.h"
+#include <iostream>
+#include <stdint.h>
+
+using namespace std;
+
+// The phases of the decode pipeline that are timed separately
+enum StatsPhase {
+  PHASE_READ,      // reading the input and splitting it into lines/words
+  PHASE_VALIDATE,  // checkInstSyntax
+  PHASE_LOOKUP,    // OpcodeTable::getOpcode
+  PHASE_DECODE,    // decodeRType/decodeIType/decodeJType
+  PHASE_FORMAT,    // formatting assembly text
+  PHASE_WRITE,     // writing output
+  NUM_PHASES
+};
+
+/* This class collects timing and counters for the decode pipeline: time and
+ * calls per phase, instructions per Opcode and InstType, bytes read and
+ * written, and peak resident memory.  Phase times are summed over all
+ * threads.  Each thread counts into its own private counters, which are
+ * merged when the thread exits, so counting needs no locking.  Nothing is
+ * counted until enable() is called.
+ *
+ * The instrumentation points use the STATS_* macros below, which compile
+ * to nothing unless the program is built with -DDECODE_STATS.
+ */
+class DecodeStats {
+
+ public:
+
+  // Starts collecting.  The report is printed to stderr (as JSON if json is
+  // true) when the program exits.
+  static void enable(bool json);
+
+  // Returns true if statistics are being collected
+  static bool isEnabled() { return enabled; };
+
+  // Counts one decoded instruction with the given Opcode
+  static void countOpcode(Opcode o);
+
+  // Adds to the byte counters
+  static void addBytesRead(uint64_t bytes);
+  static void addBytesWritten(uint64_t bytes);
+
+  // Adds ticks (see readTicks()) and one call to a phase
+  static void addPhaseTime(StatsPhase phase, uint64_t ticks);
+
+  // Returns a timestamp for phase timing in a fast, CPU-specific unit
+  static uint64_t readTicks();
+
+  // Prints the statistics collected so far
+  static void report(ostream& out, bool json);
+
+  // Times the enclosing scope as one call to a phase
+  class PhaseTimer {
+   public:
+    PhaseTimer(StatsPhase phase) : myPhase(phase), myStart(enabled ? readTicks() : 0) {};
+    ~PhaseTimer() { if (enabled) addPhaseTime(myPhase, readTicks() - myStart); };
+   private:
+    StatsPhase myPhase;
+    uint64_t myStart;
+  };
+
+ private:
+
+  static bool enabled;
+
+  // Prints the report to stderr; registered with atexit by enable()
+  static void reportAtExit();
+
+};
+
+#ifdef DECODE_STATS
+#define STATS_CONCAT2(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT2(a, b)
+#define STATS_PHASE(phase) DecodeStats::PhaseTimer STATS_CONCAT(statsTimer, __LINE__)(phase)
+#define STATS_OPCODE(o) do { if (DecodeStats::isEnabled()) DecodeStats::countOpcode(o); } while (0)
+#define STATS_BYTES_READ(n) do { if (DecodeStats::isEnabled()) DecodeStats::addBytesRead(n); } while (0)
+#define STATS_BYTES_WRITTEN(n) do { if (DecodeStats::isEnabled()) DecodeStats::addBytesWritten(n); } while (0)
+#else
+#define STATS_PHASE(phase) do { } while (0)
+#define STATS_OPCODE(o) do { } while (0)
+#define STATS_BYTES_READ(n) do { } while (0)
+#define STATS_BYTES_WRITTEN(n) do { } while (0)
+#endif
+
+#endif
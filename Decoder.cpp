@@ -0,0 +1,70 @@
+#include "Decoder.h"
+#include <string.h>
+
+// Creates a decoder, selecting the fastest kernels for the running CPU
+Decoder::Decoder() {
+}
+
+// This function decodes count words into the first count elements of out.
+// A word that is not a supported instruction becomes an Instruction with
+// the opcode UNDEFINED.  Returns the number of words that were supported.
+size_t Decoder::decode(const uint32_t *words, size_t count, Instruction *out) noexcept {
+  size_t decoded = 0;
+  for (size_t n = 0; n < count; n++)
+    if (decode(words[n], out[n]))
+      decoded++;
+  return decoded;
+}
+
+// This function decodes a single word into i.  Returns false, leaving i
+// an UNDEFINED Instruction holding the word, if the word is not a
+// supported instruction.
+bool Decoder::decode(uint32_t word, Instruction& i) noexcept {
+  if (myParser.decodeWord(word, i))
+    return true;
+
+  i = Instruction();
+  i.setWord(word);
+  return false;
+}
+
+// This function formats instructions into buffer, which holds size bytes,
+// one line per Instruction ending in '\n': the assembly text, preceded by
+// the 32 character encoding and a tab if withEncoding is set, as Binary
+// prints it.  An UNDEFINED Instruction gives an empty line, so line n
+// always belongs to instructions[n].  Stops before the first line that
+// does not fit.  Returns the number of Instructions formatted and sets
+// used to the number of bytes written.
+size_t Decoder::format(const Instruction *instructions, size_t count, char *buffer, size_t size,
+                       size_t& used, bool withEncoding) noexcept {
+  char line[maxLineLength];
+  size_t n;
+
+  used = 0;
+  for (n = 0; n < count; n++) {
+    char *end = line;
+    if (withEncoding) {
+      uint32_t word = instructions[n].getWord();
+      for (int bit = 31; bit >= 0; bit--)
+        *end++ = '0' + ((word >> bit) & 1);
+      *end++ = '\t';
+    }
+    end += formatInstruction(instructions[n], end);
+    *end++ = '\n';
+
+    // Lines are built aside so that one that does not fit is never cut short
+    size_t length = end - line;
+    if (length > size - used)
+      break;
+    memcpy(buffer + used, line, length);
+    used += length;
+  }
+  return n;
+}
+
+// This function writes the assembly text of i, without a newline, into
+// out, which must hold at least maxAssemblyLength bytes.  Returns its
+// length, 0 for an UNDEFINED Instruction.
+int Decoder::formatInstruction(const Instruction& i, char *out) noexcept {
+  return myParser.formatAssembly(i, out);
+}
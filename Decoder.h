@@ -0,0 +1,65 @@
+#ifndef __DECODER_H__
+#define __DECODER_H__
+
+#include "BinaryParser.h"
+#include "Instruction.h"
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class is the interface of the decoder library (libmipsdecode.a and
+ * libmipsdecode.so) for programs that already hold instruction words in
+ * memory.  It decodes a caller's array of words into a caller's array of
+ * Instructions, and formats Instructions into a caller's character buffer.
+ *
+ * Nothing here reads or writes files, throws, or allocates: the tables are
+ * compile time constants, and all memory is supplied by the caller.  A
+ * Decoder holds no state between calls beyond what it was constructed with,
+ * but is not meant to be shared between threads; give each thread its own.
+ */
+class Decoder {
+
+ public:
+
+  // Creates a decoder, selecting the fastest kernels for the running CPU
+  Decoder();
+
+  // This function decodes count words into the first count elements of out.
+  // A word that is not a supported instruction becomes an Instruction with
+  // the opcode UNDEFINED.  Returns the number of words that were supported.
+  size_t decode(const uint32_t *words, size_t count, Instruction *out) noexcept;
+
+  // This function decodes a single word into i.  Returns false, leaving i
+  // an UNDEFINED Instruction holding the word, if the word is not a
+  // supported instruction.
+  bool decode(uint32_t word, Instruction& i) noexcept;
+
+  // This function formats instructions into buffer, which holds size bytes,
+  // one line per Instruction ending in '\n': the assembly text, preceded by
+  // the 32 character encoding and a tab if withEncoding is set, as Binary
+  // prints it.  An UNDEFINED Instruction gives an empty line, so line n
+  // always belongs to instructions[n].  Stops before the first line that
+  // does not fit.  Returns the number of Instructions formatted and sets
+  // used to the number of bytes written.
+  size_t format(const Instruction *instructions, size_t count, char *buffer, size_t size,
+                size_t& used, bool withEncoding = false) noexcept;
+
+  // This function writes the assembly text of i, without a newline, into
+  // out, which must hold at least maxAssemblyLength bytes.  Returns its
+  // length, 0 for an UNDEFINED Instruction.
+  int formatInstruction(const Instruction& i, char *out) noexcept;
+
+  // Longest assembly text of one Instruction
+  const static int maxAssemblyLength = BinaryParser::maxAssemblyLength;
+
+  // Longest line format() writes for one Instruction
+  const static int maxLineLength = 32 + 1 + maxAssemblyLength + 1;
+
+ private:
+
+  BinaryParser myParser;     // decodes and formats; holds no Instructions
+
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "BinaryParser.h"
+#include "CorpusGenerator.h"
+#include "OutputWriter.h"
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* This file writes a deterministic synthetic corpus of MIPS instruction
+ * encodings to stdout, for benchmarking Binary.
+ *
+ * Usage: GenCorpus <count> [--seed S] [--mix add=3,lb=1,...] [-r|--raw big|little]
+ *   The default is one line of 32 '0'/'1' characters per instruction, with
+ *   every supported opcode equally likely.  With -r the corpus is a raw image
+ *   of 4 byte words in the given byte order.
+ */
+
+int main(int argc, char *argv[]) {
+  size_t count = 0;
+  uint64_t seed = 1;
+  string mix;
+  InputFormat format = TEXT_INPUT;
+
+  for (int arg = 1; arg < argc; arg++) {
+    if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc)
+      seed = strtoull(argv[++arg], NULL, 10);
+    else if (strcmp(argv[arg], "--mix") == 0 && arg + 1 < argc)
+      mix = argv[++arg];
+    else if (strcmp(argv[arg], "-r") == 0 || strcmp(argv[arg], "--raw") == 0) {
+      arg++;
+      if (arg < argc && strcmp(argv[arg], "big") == 0)
+        format = RAW_BIG_ENDIAN;
+      else if (arg < argc && strcmp(argv[arg], "little") == 0)
+        format = RAW_LITTLE_ENDIAN;
+      else {
+        cerr << "Byte order for raw output must be big or little." << endl;
+        exit(1);
+      }
+    }
+    else if (argv[arg][0] >= '0' && argv[arg][0] <= '9' &&
+             strspn(argv[arg], "0123456789") == strlen(argv[arg]))
+      count = strtoull(argv[arg], NULL, 10);
+    else {
+      cerr << "Unknown argument " << argv[arg] << "." << endl;
+      exit(1);
+    }
+  }
+
+  if (count == 0) {
+    cerr << "Need to specify the number of instructions to generate." << endl;
+    exit(1);
+  }
+
+  CorpusGenerator generator(seed);
+  if (!mix.empty() && !generator.setMix(mix)) {
+    cerr << "Opcode mix must be a list such as add=3,lb=1,j=1." << endl;
+    exit(1);
+  }
+
+  OutputWriter out(STDOUT_FILENO);
+  for (size_t n = 0; n < count; n++) {
+    uint32_t word = generator.nextWord();
+    if (format == TEXT_INPUT) {
+      out.appendBinary(word);
+      out.endLine();
+    }
+    else {
+      char bytes[4];
+      BinaryParser::packRawWord(word, format, bytes);
+      out.append(string_view(bytes, 4));
+    }
+  }
+  return out.flush() ? 0 : 1;
+}
@@ -2,38 +2,56 @@
 
 // Creates a default instruction that has the opcode UNDEFINED
 Instruction::Instruction() {
+  myWord = 0;
+  myImmediate = 0;
   myOpcode = UNDEFINED;
   myRS = myRT = myRD = NumRegisters;
 }
 
 // Constructs new instruction and initializes fields according to arguments:
 // opcode, first source register, second source register, destination
-// register, and immediate value
-Instruction::Instruction(Opcode op, string op_name, Register rs, Register rt, Register rd, int imm) {
-  setValues(op, op_name, rs, rt, rd, imm);
+// register, and immediate value.  Unused registers are NumRegisters.
+Instruction::Instruction(Opcode op, int rs, int rt, int rd, int imm) {
+  myWord = 0;
+  setValues(op, rs, rt, rd, imm);
 }
 
 // Allows you to set all the fields of the Instruction:
 // opcode, first source register, second source register, destination
-// register, and immediate value
-void Instruction::setValues(Opcode op, string op_name, Register rs, Register rt, Register rd, int imm) {
+// register, and immediate value.  Unused registers are NumRegisters.
+void Instruction::setValues(Opcode op, int rs, int rt, int rd, int imm) {
   myOpcode = op;
-  myOpcodeName = op_name;
   if (op < 0 || op >= UNDEFINED)
     myOpcode = UNDEFINED;
 
-  myRS = rs;
-  myRT = rt;
-  myRD = rd;
+  myRS = (rs < 0 || rs > NumRegisters) ? NumRegisters : rs;
+  myRT = (rt < 0 || rt > NumRegisters) ? NumRegisters : rt;
+  myRD = (rd < 0 || rd > NumRegisters) ? NumRegisters : rd;
   myImmediate = imm;
 }
 
+// Return's the opcode name as a string
+string Instruction::getOpcodeName() const {
+  // Names live in the opcode table, shared by every Instruction
+  static OpcodeTable opcodes;
+
+  if (myOpcode == UNDEFINED)
+    return "";
+  return string(opcodes.getOpcodeName((Opcode)myOpcode));
+}
+
+// Returns the assembly name of register number reg ("$8"), or an
+// empty string for NumRegisters
+Register Instruction::getRegisterName(int reg) {
+  return Register(RegisterTable::getName(reg));
+}
+
 // Returns a string which represents all of the fields 
-string Instruction::getString() {
+string Instruction::getString() const {
   stringstream s ;
-  s << "OP: \t" << myOpcode << "\t" << "RD: " << myRD << "\t" << 
-    "RS: " << myRS << "\t" << "RT: " << "\t" << myRT << "\t" <<
+  s << "OP: \t" << (int)myOpcode << "\t" << "RD: " << getRD() << "\t" << 
+    "RS: " << getRS() << "\t" << "RT: " << "\t" << getRT() << "\t" <<
     "Imm: " << myImmediate;
   
   return s.str();
-}
\ No newline at end of file
+}
@@ -4,10 +4,18 @@
 #include "OpcodeTable.h"
 #include "RegisterTable.h"
 #include <sstream>
+#include <bitset>
+#include <type_traits>
+#include <stdint.h>
 
 /* This class provides an internal representation for a MIPS assembly instruction.
- * Any of the fields can be queried.  Additionally, the class stores a 32 bit binary
- * encoding of the MIPS instruction.
+ * Any of the fields can be queried.  Additionally, the class stores the 32 bit
+ * binary encoding of the MIPS instruction.
+ *
+ * Instructions are small plain values (register numbers rather than names, the
+ * raw word rather than its text) so that large programs can be held in memory
+ * and copied cheaply.  The opcode name, register names and encoding text are
+ * derived on demand.
  */
 class Instruction {
 
@@ -18,64 +26,72 @@ class Instruction {
 
   // Constructs new instruction and initializes fields according to arguments:
   // opcode, first source register, second source register, destination
-  // register, and immediate value
-  Instruction(Opcode op, string op_name, Register rs, Register rt, Register rd, int imm);
-
-  // Destructor for the instruction
-  ~Instruction() {};
+  // register, and immediate value.  Unused registers are NumRegisters.
+  Instruction(Opcode op, int rs, int rt, int rd, int imm);
 
   // Allows you to set all the fields of the Instruction:
   // opcode, first source register, second source register, destination
-  // register, and immediate value
-  void setValues(Opcode op, string op_name, Register rs, Register rt, Register rd, int imm);
+  // register, and immediate value.  Unused registers are NumRegisters.
+  void setValues(Opcode op, int rs, int rt, int rd, int imm);
+
+  // This function sets the 32 bit word the instruction was decoded from
+  void setWord(uint32_t word) { myWord = word; };
 
-  // This function sets a binary string as the encoding of 
-  // an instruction
-  void setEncoding(string encoding) { myEncoding = encoding;}
+  // Returns the 32 bit word the instruction was decoded from
+  uint32_t getWord() const    { return myWord; };
 
-  // Return instruction's encoding
-  string getEncoding() { return myEncoding; }
+  // Return instruction's encoding as a string of 32 '0'/'1' characters
+  string getEncoding() const  { return bitset<32>(myWord).to_string(); };
 
   // Returns the Opcode of the instruction
-  Opcode getOpcode()   { return myOpcode; }
+  Opcode getOpcode() const    { return (Opcode)myOpcode; };
 
   // Return's the opcode name as a string
-  string getOpcodeName()  { return myOpcodeName; }
+  string getOpcodeName() const;
 
-  // Returns the register used as the first source operand
-  Register getRS()     { return myRS; };
+  // Returns the name of the register used as the first source operand,
+  // or an empty string if there is none
+  Register getRS() const      { return getRegisterName(myRS); };
 
-  // Returns the register used as the second source operand
-  Register getRT()     { return myRT; };
+  // Returns the name of the register used as the second source operand,
+  // or an empty string if there is none
+  Register getRT() const      { return getRegisterName(myRT); };
 
-  // Returns the register used as the destination register
-  Register getRD()     { return myRD; };
+  // Returns the name of the register used as the destination register,
+  // or an empty string if there is none
+  Register getRD() const      { return getRegisterName(myRD); };
 
-  // Returns the value of the instruction's immediate field
-  int getImmediate()   { return myImmediate; };
+  // Returns the number of the first source register, or NumRegisters
+  int getRSNum() const        { return myRS; };
 
-  // Returns a string which represents all of the fields 
-  string getString();
+  // Returns the number of the second source register, or NumRegisters
+  int getRTNum() const        { return myRT; };
 
-  // Set the string representing the instruction's assembly
-  void setAssembly(string s) { myAssembly = s;};
+  // Returns the number of the destination register, or NumRegisters
+  int getRDNum() const        { return myRD; };
 
-  // Return the string representing the instruction's assembly
-  string getAssembly() { return myAssembly; };
+  // Returns the value of the instruction's immediate field
+  int getImmediate() const    { return myImmediate; };
 
- private:
+  // Returns a string which represents all of the fields 
+  string getString() const;
 
-  Opcode myOpcode;
-  string myOpcodeName;
+ private:
 
-  Register myRS;
-  Register myRT;
-  Register myRD;
-  int myImmediate;
+  uint32_t myWord;       // the encoded instruction
+  int32_t myImmediate;
+  uint8_t myOpcode;      // an Opcode
+  uint8_t myRS;          // register numbers, NumRegisters if unused
+  uint8_t myRT;
+  uint8_t myRD;
 
-  string myAssembly; //The string containing the MIPS instruction
-  string myEncoding; //This string containing the Encoded instruction
+  // Returns the assembly name of register number reg ("$8"), or an
+  // empty string for NumRegisters
+  static Register getRegisterName(int reg);
 
 };
 
+static_assert(sizeof(Instruction) <= 16, "Instruction should stay a compact value");
+static_assert(is_trivially_copyable<Instruction>::value, "Instruction should be trivially copyable");
+
 #endif
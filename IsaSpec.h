@@ -0,0 +1,324 @@
+#ifndef __ISASPEC_H__
+#define __ISASPEC_H__
+
+#include "PerfectHash.h"
+#include <string_view>
+#include <stdint.h>
+
+using namespace std;
+
+/* This file describes the supported MIPS32 integer instructions once, as
+ * constexpr data: the fields that identify each instruction, its encoding
+ * format and the order its operands are written in.  Everything else -- the
+ * decode lookup tables, the field extractors in BinaryParser, the positions
+ * reported by OpcodeTable, the corpus generator and the mnemonic lookup --
+ * is derived from isaSpec at compile time, so adding an instruction is a
+ * matter of adding a line.
+ */
+
+// Listing of all supported MIPS instructions, in the order of isaSpec
+enum Opcode {
+  ADD,
+  ADDI,
+  XOR,
+  MULT,
+  MFLO,
+  SLL,
+  SLT,
+  SLTI,
+  LB,
+  J,
+  BEQ,
+
+  // SPECIAL (opcode 0), identified by the function field
+  SRL, SRA, SLLV, SRLV, SRAV, JR, JALR, SYSCALL, BREAK,
+  MFHI, MTHI, MTLO, MULTU, DIV, DIVU,
+  ADDU, SUB, SUBU, AND, OR, NOR, SLTU,
+
+  // REGIMM (opcode 1), identified by the rt field
+  BLTZ, BGEZ, BLTZAL, BGEZAL,
+
+  // Jumps, branches, immediates, loads and stores
+  JAL, BNE, BLEZ, BGTZ, ADDIU, SLTIU, ANDI, ORI, XORI, LUI,
+  LH, LWL, LW, LBU, LHU, LWR, SB, SH, SWL, SW, SWR,
+
+  UNDEFINED
+};
+
+// Different types of MIPS encodings
+enum InstType{
+  RTYPE,
+  ITYPE,
+  JTYPE
+};
+
+// The operands an instruction can have, and how each one is written
+enum OperandKind {
+  OPERAND_NONE,
+  OPERAND_RS,      // rs register, "$4"
+  OPERAND_RT,      // rt register
+  OPERAND_RD,      // rd register
+  OPERAND_SHAMT,   // 5 bit shift amount, decimal
+  OPERAND_IMM,     // sign extended 16 bit immediate, decimal
+  OPERAND_UIMM,    // zero extended 16 bit immediate, decimal
+  OPERAND_BRANCH,  // sign extended 16 bit word offset, as a hex byte offset
+  OPERAND_TARGET,  // 26 bit word address, as a hex byte address
+  OPERAND_MEMORY   // sign extended offset and base register, "100($4)"
+};
+
+// Whether an instruction reads or writes memory
+enum MemoryAccess {
+  ACCESS_NONE,
+  ACCESS_LOAD,     // reads memory into rt
+  ACCESS_STORE     // writes rt to memory
+};
+
+// Opcode field values that select a second level of decoding
+const int specialOpcode = 0;   // instruction given by the function field
+const int regimmOpcode = 1;    // instruction given by the rt field
+
+// Positions and widths of the fields of an instruction word
+const int opcodeShift = 26;            // The opcode field occupies bits 31-26
+const int rsShift = 21;                // The rs field occupies bits 25-21
+const int rtShift = 16;                // The rt field occupies bits 20-16
+const int rdShift = 11;                // The rd field occupies bits 15-11
+const int shamtShift = 6;              // The shift amount field occupies bits 10-6
+const uint32_t fieldMask = 0x3f;       // Mask for a 6 bit opcode/function field
+const uint32_t registerMask = 0x1f;    // Mask for a 5 bit register/shamt field
+const uint32_t immediateMask = 0xffff; // Mask for a 16 bit immediate field
+const uint32_t addressMask = 0x3ffffff; // Mask for a 26 bit jump address
+
+const int maxOperands = 3;
+
+// The description of one instruction
+struct OpcodeSpec {
+  Opcode opcode;
+  string_view name;
+  InstType instType;
+  int opField;                       // value of the opcode field
+  int subField;                      // function field (SPECIAL) or rt field (REGIMM), else -1
+  OperandKind operands[maxOperands]; // in the order they are written
+  MemoryAccess access;               // ACCESS_NONE unless given
+
+  // Returns the position of operand kind in the assembly text, or -1
+  constexpr int position(OperandKind kind) const {
+    for (int n = 0; n < maxOperands; n++)
+      if (operands[n] == kind)
+        return n;
+    return -1;
+  }
+
+  // Returns the number of operands
+  constexpr int numOperands() const {
+    int n = 0;
+    while (n < maxOperands && operands[n] != OPERAND_NONE)
+      n++;
+    return n;
+  }
+
+  // Returns true if the rs, rt or rd register is one of the operands
+  constexpr bool usesRS() const { return position(OPERAND_RS) != -1 || position(OPERAND_MEMORY) != -1; }
+  constexpr bool usesRT() const { return position(OPERAND_RT) != -1; }
+  constexpr bool usesRD() const { return position(OPERAND_RD) != -1; }
+
+  // Returns true if the instruction reads or writes memory
+  constexpr bool isLoad() const  { return access == ACCESS_LOAD; }
+  constexpr bool isStore() const { return access == ACCESS_STORE; }
+
+  // Returns the kind of the immediate operand, or OPERAND_NONE if there is none
+  constexpr OperandKind immediateKind() const {
+    for (int n = 0; n < maxOperands; n++)
+      if (operands[n] >= OPERAND_SHAMT)
+        return operands[n];
+    return OPERAND_NONE;
+  }
+
+  // Returns the bits of the word that identify the instruction
+  constexpr uint32_t fixedBits() const {
+    uint32_t bits = (uint32_t)opField << opcodeShift;
+    if (opField == specialOpcode)
+      bits |= (uint32_t)subField;
+    else if (opField == regimmOpcode)
+      bits |= (uint32_t)subField << rtShift;
+    return bits;
+  }
+
+  // Returns the bits of the word that hold the operands
+  constexpr uint32_t operandBits() const {
+    uint32_t bits = 0;
+    if (usesRS())
+      bits |= registerMask << rsShift;
+    if (usesRT())
+      bits |= registerMask << rtShift;
+    if (usesRD())
+      bits |= registerMask << rdShift;
+    switch (immediateKind()) {
+      case OPERAND_SHAMT:  bits |= registerMask << shamtShift; break;
+      case OPERAND_TARGET: bits |= addressMask; break;
+      case OPERAND_NONE:   break;
+      default:             bits |= immediateMask; break;
+    }
+    return bits;
+  }
+};
+
+// Shorthands for the operand lists below
+#define ISA_OPERANDS(a, b, c) { OPERAND_##a, OPERAND_##b, OPERAND_##c }
+
+// The supported instructions, indexed by Opcode.  Operand order follows the
+// established output of this tool: branches comparing two registers write
+// rt before rs, and loads and stores write "rt, offset(rs)".  Loads and
+// stores also give their MemoryAccess.
+inline constexpr OpcodeSpec isaSpec[UNDEFINED] = {
+  { ADD,     "add",     RTYPE,  0, 0x20, ISA_OPERANDS(RD, RS, RT) },
+  { ADDI,    "addi",    ITYPE,  8,   -1, ISA_OPERANDS(RT, RS, IMM) },
+  { XOR,     "xor",     RTYPE,  0, 0x26, ISA_OPERANDS(RD, RS, RT) },
+  { MULT,    "mult",    RTYPE,  0, 0x18, ISA_OPERANDS(RS, RT, NONE) },
+  { MFLO,    "mflo",    RTYPE,  0, 0x12, ISA_OPERANDS(RD, NONE, NONE) },
+  { SLL,     "sll",     RTYPE,  0, 0x00, ISA_OPERANDS(RD, RT, SHAMT) },
+  { SLT,     "slt",     RTYPE,  0, 0x2a, ISA_OPERANDS(RD, RS, RT) },
+  { SLTI,    "slti",    ITYPE, 10,   -1, ISA_OPERANDS(RT, RS, IMM) },
+  { LB,      "lb",      ITYPE, 32,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { J,       "j",       JTYPE,  2,   -1, ISA_OPERANDS(TARGET, NONE, NONE) },
+  { BEQ,     "beq",     ITYPE,  4,   -1, ISA_OPERANDS(RT, RS, BRANCH) },
+
+  { SRL,     "srl",     RTYPE,  0, 0x02, ISA_OPERANDS(RD, RT, SHAMT) },
+  { SRA,     "sra",     RTYPE,  0, 0x03, ISA_OPERANDS(RD, RT, SHAMT) },
+  { SLLV,    "sllv",    RTYPE,  0, 0x04, ISA_OPERANDS(RD, RT, RS) },
+  { SRLV,    "srlv",    RTYPE,  0, 0x06, ISA_OPERANDS(RD, RT, RS) },
+  { SRAV,    "srav",    RTYPE,  0, 0x07, ISA_OPERANDS(RD, RT, RS) },
+  { JR,      "jr",      RTYPE,  0, 0x08, ISA_OPERANDS(RS, NONE, NONE) },
+  { JALR,    "jalr",    RTYPE,  0, 0x09, ISA_OPERANDS(RD, RS, NONE) },
+  { SYSCALL, "syscall", RTYPE,  0, 0x0c, ISA_OPERANDS(NONE, NONE, NONE) },
+  { BREAK,   "break",   RTYPE,  0, 0x0d, ISA_OPERANDS(NONE, NONE, NONE) },
+  { MFHI,    "mfhi",    RTYPE,  0, 0x10, ISA_OPERANDS(RD, NONE, NONE) },
+  { MTHI,    "mthi",    RTYPE,  0, 0x11, ISA_OPERANDS(RS, NONE, NONE) },
+  { MTLO,    "mtlo",    RTYPE,  0, 0x13, ISA_OPERANDS(RS, NONE, NONE) },
+  { MULTU,   "multu",   RTYPE,  0, 0x19, ISA_OPERANDS(RS, RT, NONE) },
+  { DIV,     "div",     RTYPE,  0, 0x1a, ISA_OPERANDS(RS, RT, NONE) },
+  { DIVU,    "divu",    RTYPE,  0, 0x1b, ISA_OPERANDS(RS, RT, NONE) },
+  { ADDU,    "addu",    RTYPE,  0, 0x21, ISA_OPERANDS(RD, RS, RT) },
+  { SUB,     "sub",     RTYPE,  0, 0x22, ISA_OPERANDS(RD, RS, RT) },
+  { SUBU,    "subu",    RTYPE,  0, 0x23, ISA_OPERANDS(RD, RS, RT) },
+  { AND,     "and",     RTYPE,  0, 0x24, ISA_OPERANDS(RD, RS, RT) },
+  { OR,      "or",      RTYPE,  0, 0x25, ISA_OPERANDS(RD, RS, RT) },
+  { NOR,     "nor",     RTYPE,  0, 0x27, ISA_OPERANDS(RD, RS, RT) },
+  { SLTU,    "sltu",    RTYPE,  0, 0x2b, ISA_OPERANDS(RD, RS, RT) },
+
+  { BLTZ,    "bltz",    ITYPE,  1, 0x00, ISA_OPERANDS(RS, BRANCH, NONE) },
+  { BGEZ,    "bgez",    ITYPE,  1, 0x01, ISA_OPERANDS(RS, BRANCH, NONE) },
+  { BLTZAL,  "bltzal",  ITYPE,  1, 0x10, ISA_OPERANDS(RS, BRANCH, NONE) },
+  { BGEZAL,  "bgezal",  ITYPE,  1, 0x11, ISA_OPERANDS(RS, BRANCH, NONE) },
+
+  { JAL,     "jal",     JTYPE,  3,   -1, ISA_OPERANDS(TARGET, NONE, NONE) },
+  { BNE,     "bne",     ITYPE,  5,   -1, ISA_OPERANDS(RT, RS, BRANCH) },
+  { BLEZ,    "blez",    ITYPE,  6,   -1, ISA_OPERANDS(RS, BRANCH, NONE) },
+  { BGTZ,    "bgtz",    ITYPE,  7,   -1, ISA_OPERANDS(RS, BRANCH, NONE) },
+  { ADDIU,   "addiu",   ITYPE,  9,   -1, ISA_OPERANDS(RT, RS, IMM) },
+  { SLTIU,   "sltiu",   ITYPE, 11,   -1, ISA_OPERANDS(RT, RS, IMM) },
+  { ANDI,    "andi",    ITYPE, 12,   -1, ISA_OPERANDS(RT, RS, UIMM) },
+  { ORI,     "ori",     ITYPE, 13,   -1, ISA_OPERANDS(RT, RS, UIMM) },
+  { XORI,    "xori",    ITYPE, 14,   -1, ISA_OPERANDS(RT, RS, UIMM) },
+  { LUI,     "lui",     ITYPE, 15,   -1, ISA_OPERANDS(RT, UIMM, NONE) },
+  { LH,      "lh",      ITYPE, 33,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { LWL,     "lwl",     ITYPE, 34,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { LW,      "lw",      ITYPE, 35,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { LBU,     "lbu",     ITYPE, 36,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { LHU,     "lhu",     ITYPE, 37,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { LWR,     "lwr",     ITYPE, 38,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_LOAD },
+  { SB,      "sb",      ITYPE, 40,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_STORE },
+  { SH,      "sh",      ITYPE, 41,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_STORE },
+  { SWL,     "swl",     ITYPE, 42,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_STORE },
+  { SW,      "sw",      ITYPE, 43,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_STORE },
+  { SWR,     "swr",     ITYPE, 46,   -1, ISA_OPERANDS(RT, MEMORY, NONE), ACCESS_STORE },
+};
+
+#undef ISA_OPERANDS
+
+// Returns true if exactly the instructions with a memory operand are marked
+// as loads or stores
+constexpr bool memoryAccessConsistent() {
+  for (int o = 0; o < (int)UNDEFINED; o++)
+    if ((isaSpec[o].position(OPERAND_MEMORY) != -1) != (isaSpec[o].access != ACCESS_NONE))
+      return false;
+  return true;
+}
+
+static_assert(memoryAccessConsistent(), "every load and store must give its MemoryAccess");
+
+// Direct-indexed decode tables generated from isaSpec.  opcode is indexed by
+// the opcode field; SPECIAL instructions are found in funct, indexed by the
+// function field, and REGIMM instructions in regimm, indexed by the rt field.
+// Entries with no instruction are UNDEFINED.
+struct DecodeTables {
+  Opcode opcode[fieldMask + 1];
+  Opcode funct[fieldMask + 1];
+  Opcode regimm[registerMask + 1];
+  bool consistent;       // false if isaSpec is out of order or has clashes
+};
+
+// Builds the decode tables from isaSpec
+constexpr DecodeTables buildDecodeTables() {
+  DecodeTables t = {};
+  for (uint32_t n = 0; n <= fieldMask; n++)
+    t.opcode[n] = t.funct[n] = UNDEFINED;
+  for (uint32_t n = 0; n <= registerMask; n++)
+    t.regimm[n] = UNDEFINED;
+  t.consistent = true;
+
+  for (int o = 0; o < (int)UNDEFINED; o++) {
+    const OpcodeSpec& spec = isaSpec[o];
+    Opcode *slot = &t.opcode[spec.opField];
+    if (spec.opField == specialOpcode)
+      slot = &t.funct[spec.subField];
+    else if (spec.opField == regimmOpcode)
+      slot = &t.regimm[spec.subField];
+
+    if (spec.opcode != (Opcode)o || *slot != UNDEFINED)
+      t.consistent = false;
+    *slot = (Opcode)o;
+  }
+  return t;
+}
+
+inline constexpr DecodeTables decodeTables = buildDecodeTables();
+
+static_assert(decodeTables.consistent,
+              "isaSpec must be in Opcode order and encode every instruction uniquely");
+
+// Returns the Opcode of an instruction word, or UNDEFINED if no supported
+// instruction matches
+constexpr Opcode lookupOpcode(uint32_t word) {
+  int op = (word >> opcodeShift) & fieldMask;
+  if (op == specialOpcode)
+    return decodeTables.funct[word & fieldMask];
+  if (op == regimmOpcode)
+    return decodeTables.regimm[(word >> rtShift) & registerMask];
+  return decodeTables.opcode[op];
+}
+
+static_assert(lookupOpcode(0x02324020) == ADD && lookupOpcode(0x8e620064) == LW &&
+              lookupOpcode(0x04110003) == BGEZAL && lookupOpcode(0xfc000000) == UNDEFINED,
+              "decode tables disagree with the MIPS32 encodings");
+
+// The mnemonic of every instruction, with its Opcode
+struct OpcodeNames {
+  NameEntry entries[UNDEFINED];
+};
+
+// Collects the mnemonics from isaSpec
+constexpr OpcodeNames buildOpcodeNames() {
+  OpcodeNames names = {};
+  for (int o = 0; o < (int)UNDEFINED; o++)
+    names.entries[o] = NameEntry{ isaSpec[o].name, o };
+  return names;
+}
+
+inline constexpr OpcodeNames opcodeNames = buildOpcodeNames();
+
+// Mnemonic to Opcode lookup, built at compile time
+inline constexpr PerfectHash<256> opcodeNumbers(opcodeNames.entries, UNDEFINED);
+
+static_assert(opcodeNumbers.isPerfect(), "no perfect hash found for the mnemonics");
+
+#endif
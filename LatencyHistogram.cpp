@@ -0,0 +1,84 @@
+#include "LatencyHistogram.h"
+#include <iomanip>
+
+// Creates an empty histogram
+LatencyHistogram::LatencyHistogram() {
+  for (int b = 0; b < numBuckets; b++)
+    myBuckets[b] = 0;
+  myCount = 0;
+  myTotal = 0;
+  myMax = 0;
+}
+
+// Records one latency of nanoseconds
+void LatencyHistogram::record(uint64_t nanoseconds) {
+  myBuckets[bucketFor(nanoseconds)]++;
+  myCount++;
+  myTotal += nanoseconds;
+  if (nanoseconds > myMax)
+    myMax = nanoseconds;
+}
+
+// Adds the latencies recorded by other to this histogram
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (int b = 0; b < numBuckets; b++)
+    myBuckets[b] += other.myBuckets[b];
+  myCount += other.myCount;
+  myTotal += other.myTotal;
+  if (other.myMax > myMax)
+    myMax = other.myMax;
+}
+
+// Returns the latency below which the given fraction (0 to 1) of the
+// latencies fall, rounded up to the end of its bucket
+uint64_t LatencyHistogram::getPercentile(double fraction) const {
+  if (myCount == 0)
+    return 0;
+
+  // The rank of the latency wanted, counting from 1
+  uint64_t rank = (uint64_t)(fraction * myCount + 0.5);
+  if (rank < 1)
+    rank = 1;
+
+  uint64_t seen = 0;
+  for (int b = 0; b < numBuckets; b++) {
+    seen += myBuckets[b];
+    if (seen >= rank)
+      return bucketLimit(b) < myMax ? bucketLimit(b) : myMax;
+  }
+  return myMax;
+}
+
+// Prints the count, mean and the 50th, 90th, 99th and 99.9th percentiles
+// on one line, in microseconds
+void LatencyHistogram::report(ostream& out) const {
+  double mean = myCount == 0 ? 0 : (double)myTotal / myCount;
+
+  out << myCount << " requests, latency us: mean " << fixed << setprecision(1)
+      << mean / 1000 << ", p50 " << getPercentile(0.50) / 1000.0
+      << ", p90 " << getPercentile(0.90) / 1000.0
+      << ", p99 " << getPercentile(0.99) / 1000.0
+      << ", p99.9 " << getPercentile(0.999) / 1000.0
+      << ", max " << myMax / 1000.0 << defaultfloat << endl;
+}
+
+// Values below subBuckets have a bucket each; above that, the bucket is
+// given by the position of the top bit and the subBucketBits below it
+int LatencyHistogram::bucketFor(uint64_t value) {
+  if (value < (uint64_t)subBuckets)
+    return (int)value;
+
+  int top = 63 - __builtin_clzll(value);
+  int shift = top - subBucketBits;
+  return (shift + 1) * subBuckets + (int)((value >> shift) & (subBuckets - 1));
+}
+
+// This function returns the largest value in bucket
+uint64_t LatencyHistogram::bucketLimit(int bucket) {
+  if (bucket < subBuckets)
+    return bucket;
+
+  int shift = bucket / subBuckets - 1;
+  uint64_t first = (uint64_t)(subBuckets + bucket % subBuckets) << shift;
+  return first + ((uint64_t)1 << shift) - 1;
+}
@@ -0,0 +1,61 @@
+#ifndef __LATENCYHISTOGRAM_H__
+#define __LATENCYHISTOGRAM_H__
+
+#include <iostream>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class records latencies in nanoseconds in a fixed set of
+ * log-linear buckets: every power of two is split into 8 equal buckets, so
+ * a percentile is accurate to within 12.5% however many latencies are
+ * recorded, and memory use never grows.  Histograms of separate threads or
+ * sessions can be merged.
+ */
+class LatencyHistogram {
+
+ public:
+
+  // Creates an empty histogram
+  LatencyHistogram();
+
+  // Records one latency of nanoseconds
+  void record(uint64_t nanoseconds);
+
+  // Adds the latencies recorded by other to this histogram
+  void merge(const LatencyHistogram& other);
+
+  // Returns the number of latencies recorded
+  uint64_t getCount() const   { return myCount; };
+
+  // Returns the largest latency recorded, or 0 if there are none
+  uint64_t getMax() const     { return myMax; };
+
+  // Returns the latency below which the given fraction (0 to 1) of the
+  // latencies fall, rounded up to the end of its bucket
+  uint64_t getPercentile(double fraction) const;
+
+  // Prints the count, mean and the 50th, 90th, 99th and 99.9th percentiles
+  // on one line, in microseconds
+  void report(ostream& out) const;
+
+ private:
+
+  const static int subBuckets = 8;             // buckets per power of two
+  const static int subBucketBits = 3;
+  const static int numBuckets = 64 * subBuckets;
+
+  uint64_t myBuckets[numBuckets];
+  uint64_t myCount;
+  uint64_t myTotal;                            // sum of the latencies
+  uint64_t myMax;
+
+  // This function returns the bucket holding value
+  static int bucketFor(uint64_t value);
+
+  // This function returns the largest value in bucket
+  static uint64_t bucketLimit(int bucket);
+
+};
+
+#endif
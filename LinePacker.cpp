@@ -0,0 +1,100 @@
+#include "LinePacker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINEPACKER_X86 1
+#endif
+
+// Portable kernel: checks and shifts in one character at a time
+static bool packScalar(const char *line, uint32_t& word) {
+  uint32_t bits = 0;
+  for (int pos = 0; pos < LinePacker::lineLength; pos++) {
+    unsigned char c = line[pos] - '0';
+    if (c > 1)
+      return false;
+    bits = (bits << 1) | c;
+  }
+  word = bits;
+  return true;
+}
+
+#ifdef LINEPACKER_X86
+
+// Reverses the order of the 32 bits of x
+static inline uint32_t reverseBits(uint32_t x) {
+  x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+  x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+  return __builtin_bswap32(x);
+}
+
+// SSE2 kernel: '0' (0x30) and '1' (0x31) are the only bytes equal to 0x30
+// once their low bit is cleared.  Shifting each byte's low bit into its top
+// bit lets movemask collect the bits, character 0 landing in bit 0.
+__attribute__((target("sse2")))
+static bool packSSE2(const char *line, uint32_t& word) {
+  __m128i lo = _mm_loadu_si128((const __m128i *)line);
+  __m128i hi = _mm_loadu_si128((const __m128i *)(line + 16));
+  __m128i clearLow = _mm_set1_epi8((char)0xfe);
+  __m128i zero = _mm_set1_epi8('0');
+
+  int valid = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, clearLow), zero)) &
+              _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(hi, clearLow), zero));
+  if (valid != 0xffff)
+    return false;
+
+  uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_slli_epi16(lo, 7)) |
+                  ((uint32_t)_mm_movemask_epi8(_mm_slli_epi16(hi, 7)) << 16);
+  word = reverseBits(bits);
+  return true;
+}
+
+// AVX2 kernel: the same test on all 32 bytes at once.  The bytes are
+// reversed first so movemask yields the word with character 0 as bit 31.
+__attribute__((target("avx2")))
+static bool packAVX2(const char *line, uint32_t& word) {
+  __m256i v = _mm256_loadu_si256((const __m256i *)line);
+  __m256i valid = _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8((char)0xfe)),
+                                    _mm256_set1_epi8('0'));
+  if ((uint32_t)_mm256_movemask_epi8(valid) != 0xffffffff)
+    return false;
+
+  const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  v = _mm256_shuffle_epi8(v, reverse);
+  v = _mm256_permute2x128_si256(v, v, 1);
+  word = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(v, 7));
+  return true;
+}
+
+#endif
+
+// Selects the fastest kernel supported by the running CPU
+LinePacker::LinePacker() {
+  myKernel = packScalar;
+  myKernelName = "scalar";
+
+  if (!selectKernel("avx2"))
+    selectKernel("sse2");
+}
+
+// Forces a particular kernel ("scalar", "sse2" or "avx2").  Returns false,
+// leaving the current kernel in place, if it is not available on this CPU.
+bool LinePacker::selectKernel(string name) {
+  if (name == "scalar") {
+    myKernel = packScalar;
+  }
+#ifdef LINEPACKER_X86
+  else if (name == "sse2" && __builtin_cpu_supports("sse2")) {
+    myKernel = packSSE2;
+  }
+  else if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+    myKernel = packAVX2;
+  }
+#endif
+  else
+    return false;
+
+  myKernelName = name;
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef __LINEPACKER_H__
+#define __LINEPACKER_H__
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class validates a line of 32 '0'/'1' characters and packs it into
+ * a 32 bit word (first character is the most significant bit) in a single
+ * step.  On x86 the work is done with vector compares and movemask: AVX2
+ * when the CPU supports it, otherwise the SSE2 baseline.  Other targets use
+ * a portable scalar loop.  The kernel is chosen once, at construction.
+ */
+class LinePacker {
+
+ public:
+
+  // Selects the fastest kernel supported by the running CPU
+  LinePacker();
+
+  // Forces a particular kernel ("scalar", "sse2" or "avx2").  Returns false,
+  // leaving the current kernel in place, if it is not available on this CPU.
+  bool selectKernel(string name);
+
+  // Returns the name of the kernel in use
+  string getKernelName() { return myKernelName; };
+
+  // Checks that the 32 characters starting at line are all '0' or '1'.  If so,
+  // packs them into word and returns true; otherwise returns false.  The
+  // caller must guarantee that 32 bytes are readable at line.
+  bool pack(const char *line, uint32_t& word) { return myKernel(line, word); };
+
+  // Number of characters in an encoded instruction
+  const static int lineLength = 32;
+
+ private:
+
+  bool (*myKernel)(const char *line, uint32_t& word);
+  string myKernelName;
+
+};
+
+#endif
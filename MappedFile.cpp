@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+#include "DecodeStats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Opens and maps the named file.  Check isOpen() for success.
+MappedFile::MappedFile(string filename) {
+  STATS_PHASE(PHASE_READ);
+  myData = NULL;
+  mySize = 0;
+  myPos = 0;
+  myOpen = false;
+  myMapped = false;
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    mySize = info.st_size;
+
+    // An empty file cannot be mapped, but is still a valid (empty) input
+    if (mySize == 0) {
+      myOpen = true;
+      close(fd);
+      return;
+    }
+
+    void *map = mmap(NULL, mySize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      madvise(map, mySize, MADV_SEQUENTIAL);
+      myData = (const char *)map;
+      myMapped = true;
+      myOpen = true;
+      STATS_BYTES_READ(mySize);
+      close(fd);
+      return;
+    }
+  }
+
+  // Pipes and other unmappable files are read into a buffer instead
+  myOpen = readAll(fd);
+  STATS_BYTES_READ(mySize);
+  close(fd);
+}
+
+// Unmaps the file and closes it
+MappedFile::~MappedFile() {
+  if (myMapped)
+    munmap((void *)myData, mySize);
+}
+
+// Fallback for files that cannot be mapped: reads fd to its end into myBuffer
+bool MappedFile::readAll(int fd) {
+  const size_t chunkSize = 1 << 16;
+  size_t used = 0;
+
+  while (true) {
+    myBuffer.resize(used + chunkSize);
+    ssize_t got = read(fd, myBuffer.data() + used, chunkSize);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got < 0)
+      return false;
+    if (got == 0)
+      break;
+    used += got;
+  }
+
+  myBuffer.resize(used);
+  myData = myBuffer.data();
+  mySize = used;
+  return true;
+}
+
+// Sets line to a view of the next line of the file, not including its
+// newline, and returns true.  Returns false once the end of the file is
+// reached.  A final line without a newline is still returned.
+bool MappedFile::getNextLine(string_view& line) {
+  return getNextLine(myPos, mySize, line);
+}
+
+// Same as above, but walks the lines of the byte range [pos, end) using
+// the caller's cursor pos, so several ranges can be walked independently.
+bool MappedFile::getNextLine(size_t& pos, size_t end, string_view& line) {
+  STATS_PHASE(PHASE_READ);
+  if (pos >= end)
+    return false;
+
+  const char *start = myData + pos;
+  const char *newline = (const char *)memchr(start, '\n', end - pos);
+  size_t length = (newline == NULL) ? end - pos : newline - start;
+
+  line = string_view(start, length);
+  pos += length + 1;
+  return true;
+}
+
+// Returns the offset of the first line that starts at or after offset,
+// or the size of the file if there is none.  Used to split the file
+// into ranges at line boundaries.
+size_t MappedFile::findLineStart(size_t offset) {
+  if (offset == 0 || offset >= mySize)
+    return offset < mySize ? offset : mySize;
+
+  // offset starts a line if the byte before it ends one
+  const char *newline = (const char *)memchr(myData + offset - 1, '\n', mySize - offset + 1);
+  return (newline == NULL) ? mySize : newline - myData + 1;
+}
@@ -0,0 +1,68 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stddef.h>
+
+using namespace std;
+
+/* This class gives read-only access to the bytes of an input file without
+ * copying them.  Regular files are memory mapped and advised for sequential
+ * access; anything that cannot be mapped (pipes, FIFOs, character devices)
+ * is read into a private buffer instead.  Lines can then be walked in place
+ * as views into the file's bytes.
+ */
+class MappedFile {
+
+ public:
+
+  // Opens and maps the named file.  Check isOpen() for success.
+  MappedFile(string filename);
+
+  // Unmaps the file and closes it
+  ~MappedFile();
+
+  // Returns true if the file was opened and its contents are available
+  bool isOpen()          { return myOpen; };
+
+  // Returns a pointer to the first byte of the file
+  const char *getData()  { return myData; };
+
+  // Returns the number of bytes in the file
+  size_t getSize()       { return mySize; };
+
+  // Sets line to a view of the next line of the file, not including its
+  // newline, and returns true.  Returns false once the end of the file is
+  // reached.  A final line without a newline is still returned.
+  bool getNextLine(string_view& line);
+
+  // Same as above, but walks the lines of the byte range [pos, end) using
+  // the caller's cursor pos, so several ranges can be walked independently.
+  bool getNextLine(size_t& pos, size_t end, string_view& line);
+
+  // Returns the offset of the first line that starts at or after offset,
+  // or the size of the file if there is none.  Used to split the file
+  // into ranges at line boundaries.
+  size_t findLineStart(size_t offset);
+
+ private:
+
+  const char *myData;    // the file's bytes (mapped or buffered)
+  size_t mySize;         // number of bytes in myData
+  size_t myPos;          // offset of the next line for getNextLine
+  bool myOpen;
+  bool myMapped;         // true if myData must be unmapped on destruction
+  vector<char> myBuffer; // holds the contents of files that cannot be mapped
+
+  // Fallback for files that cannot be mapped: reads fd to its end into myBuffer
+  bool readAll(int fd);
+
+  // MappedFiles own a mapping, so they cannot be copied
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+};
+
+#endif
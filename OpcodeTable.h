@@ -1,53 +1,37 @@
 #ifndef __OPCODE_H__
 #define __OPCODE_H__
 
+#include "IsaSpec.h"
 #include <iostream>
 #include <string>
+#include <string_view>
 
 using namespace std;
 
-// Listing of all supported MIPS instructions
-enum Opcode {
-  ADD, 
-  ADDI, 
-  XOR,
-  MULT,
-  MFLO,
-  SLL,
-  SLT,
-  SLTI,
-  LB,
-  J,
-  BEQ,
-  UNDEFINED
-};
-
-// Different types of MIPS encodings
-enum InstType{
-  RTYPE,
-  ITYPE,
-  JTYPE
-};
-
-
 /* This class represents templates for supported MIPS instructions.  For every supported
  * MIPS instruction, the OpcodeTable includes information about the opcode, expected
- * operands, and other fields.  
+ * operands, and other fields.  The information is read from isaSpec (see
+ * IsaSpec.h), so an OpcodeTable holds no data of its own.
  */
 class OpcodeTable {
 
  public:
 
-  // Initializes all the fields for every instruction in Opcode enum
-  OpcodeTable();
+  // Given an encoded instruction word, returns the MIPS opcode which represents
+  // a template for that instruction, or UNDEFINED if no supported instruction
+  // matches.
+  Opcode getOpcode(uint32_t word) { return lookupOpcode(word); };
+
+  // Given a mnemonic such as "add", returns its Opcode, or UNDEFINED if
+  // it is not a supported instruction
+  Opcode getOpcode(string_view name) { return (Opcode)opcodeNumbers.lookup(name); };
 
-  // Given a valid 6 digit encoding, returns an MIPS opcode which represents a 
-  // template for that instruction.
-  Opcode getOpcode(string opcode_field, string func_field);
+  // Given an Opcode, returns the description of that instruction
+  const OpcodeSpec& getSpec(Opcode o) { return isaSpec[o]; };
 
-  // Given a valid 6 digit encoding, returns a string with the corresponding
-  // opcode name for that instruction
-  string getOpcodeName(Opcode o);
+  // Given an Opcode, returns a string with the corresponding opcode name
+  // for that instruction
+  string_view getOpcodeName(Opcode o);
 
   // Given an Opcode, returns the position of RS field.  If field is not
   // appropriate for this Opcode, returns -1.
@@ -84,37 +68,6 @@ class OpcodeTable {
   // field.
   string getFunctField(Opcode o);
 
- private:
-
-  // Provides information about how where to find values in a MIPS assembly
-  // instruction and what pre-defined fields (opcode/funct) will be in
-  // the encoding for the given instruction.
-  struct OpcodeTableEntry {
-    string name;
-    int numOps;
-    int rdPos;
-    int rsPos;
-    int rtPos;
-    int immPos;
-    bool immLabel;
-    bool isMemoryInstr;
-
-    InstType instType;
-    string op_field;
-    string funct_field;
-
-    // Creates an initial OpcodeTableEntry with default values
-    OpcodeTableEntry() {
-      numOps = 0; 
-      rdPos = rsPos = rtPos = immPos = -1;
-      immLabel = false;
-      isMemoryInstr = false;
-    };
-  };
-
-  // The array of OpcodeTableEntries, one for each MIPS instruction supported
-  OpcodeTableEntry myArray[UNDEFINED];
-
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "OutputWriter.h"
+#include "DecodeStats.h"
+#include <charconv>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// The 8 '0'/'1' characters of every byte value, most significant bit first
+struct BinaryDigitTable {
+  char digits[256][8];
+
+  BinaryDigitTable() {
+    for (int b = 0; b < 256; b++)
+      for (int bit = 0; bit < 8; bit++)
+        digits[b][bit] = ((b >> (7 - bit)) & 1) ? '1' : '0';
+  }
+};
+
+static const BinaryDigitTable binaryDigits;
+static const char hexDigits[] = "0123456789abcdef";
+
+// Creates a writer for fd (-1 to collect output in memory) with a buffer
+// of capacity bytes
+OutputWriter::OutputWriter(int fd, FlushPolicy policy, size_t capacity) {
+  myFd = fd;
+  myPolicy = policy;
+  myBuffer.resize(capacity < 64 ? 64 : capacity);
+  myUsed = 0;
+  myError = false;
+  myBytesWritten = 0;
+}
+
+// Flushes any buffered output
+OutputWriter::~OutputWriter() {
+  flush();
+}
+
+// Appends text
+void OutputWriter::append(string_view text) {
+  // Text larger than the whole buffer goes straight to the descriptor
+  if (myFd >= 0 && text.length() > myBuffer.size()) {
+    flush();
+    writeAll(text.data(), text.length());
+    return;
+  }
+
+  reserve(text.length());
+  memcpy(myBuffer.data() + myUsed, text.data(), text.length());
+  myUsed += text.length();
+}
+
+// Appends a single character
+void OutputWriter::append(char c) {
+  reserve(1);
+  myBuffer[myUsed++] = c;
+}
+
+// Appends a signed decimal number
+void OutputWriter::appendDecimal(int64_t value) {
+  reserve(20);
+  char *start = myBuffer.data() + myUsed;
+  myUsed = to_chars(start, start + 20, value).ptr - myBuffer.data();
+}
+
+// Appends a number in lowercase hexadecimal, without a prefix
+void OutputWriter::appendHex(uint32_t value) {
+  reserve(8);
+  int digits = 1;
+  while (digits < 8 && (value >> (4 * digits)) != 0)
+    digits++;
+
+  char *out = myBuffer.data() + myUsed;
+  for (int d = digits - 1; d >= 0; d--, value >>= 4)
+    out[d] = hexDigits[value & 0xf];
+  myUsed += digits;
+}
+
+// Appends the 32 bits of word as '0'/'1' characters, most significant first
+void OutputWriter::appendBinary(uint32_t word) {
+  reserve(32);
+  char *out = myBuffer.data() + myUsed;
+  for (int byte = 0; byte < 4; byte++)
+    memcpy(out + 8 * byte, binaryDigits.digits[(word >> (24 - 8 * byte)) & 0xff], 8);
+  myUsed += 32;
+}
+
+// Ends the current line, flushing if the policy asks for it
+void OutputWriter::endLine() {
+  append('\n');
+  if (myPolicy == FLUSH_EACH_LINE)
+    flush();
+}
+
+// Appends one line of decoder output: word as '0'/'1' characters, a tab,
+// and its assembly text
+void OutputWriter::appendEncodedLine(uint32_t word, string_view assembly) {
+  appendBinary(word);
+  append('\t');
+  append(assembly);
+  endLine();
+}
+
+// Writes the buffered output to the file descriptor.  Returns false if a
+// write failed; the error is also remembered by hasError().
+bool OutputWriter::flush() {
+  if (myFd >= 0)
+    writeAll(myBuffer.data(), myUsed);
+
+  myUsed = (myFd >= 0) ? 0 : myUsed;
+  return !myError;
+}
+
+// Writes size bytes at data to the file descriptor, retrying short writes
+bool OutputWriter::writeAll(const char *data, size_t size) {
+  STATS_PHASE(PHASE_WRITE);
+  size_t done = 0;
+  while (done < size && !myError) {
+    ssize_t n = write(myFd, data + done, size - done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      myError = true;
+      break;
+    }
+    done += n;
+  }
+
+  myBytesWritten += done;
+  STATS_BYTES_WRITTEN(done);
+  return !myError;
+}
+
+// Makes room for at least n more bytes, flushing or growing the buffer
+void OutputWriter::makeRoom(size_t n) {
+  if (myFd >= 0)
+    flush();
+
+  // In-memory writers (and very long appends) grow the buffer instead
+  if (myUsed + n > myBuffer.size())
+    myBuffer.resize(2 * (myUsed + n));
+}
@@ -0,0 +1,98 @@
+#ifndef __OUTPUTWRITER_H__
+#define __OUTPUTWRITER_H__
+
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// When an OutputWriter hands its buffer to the operating system
+enum FlushPolicy {
+  FLUSH_WHEN_FULL,   // only when the buffer fills (and on flush()/destruction)
+  FLUSH_EACH_LINE    // at the end of every line, for interactive use
+};
+
+/* This class formats output directly into one large reusable byte buffer
+ * and writes it to a file descriptor with a few large write(2) calls.
+ * Numbers are formatted in place (std::to_chars and lookup tables), so
+ * nothing is allocated per line.  A writer created without a file
+ * descriptor just collects its output in memory, which lets separate
+ * threads format pieces of the output that are written out later in order.
+ */
+class OutputWriter {
+
+ public:
+
+  // Creates a writer for fd (-1 to collect output in memory) with a buffer
+  // of capacity bytes
+  OutputWriter(int fd, FlushPolicy policy = FLUSH_WHEN_FULL, size_t capacity = defaultCapacity);
+
+  // Flushes any buffered output
+  ~OutputWriter();
+
+  // Appends text
+  void append(string_view text);
+
+  // Appends a single character
+  void append(char c);
+
+  // Appends a signed decimal number
+  void appendDecimal(int64_t value);
+
+  // Appends a number in lowercase hexadecimal, without a prefix
+  void appendHex(uint32_t value);
+
+  // Appends the 32 bits of word as '0'/'1' characters, most significant first
+  void appendBinary(uint32_t word);
+
+  // Ends the current line, flushing if the policy asks for it
+  void endLine();
+
+  // Appends one line of decoder output: word as '0'/'1' characters, a tab,
+  // and its assembly text
+  void appendEncodedLine(uint32_t word, string_view assembly);
+
+  // Writes the buffered output to the file descriptor.  Returns false if a
+  // write failed; the error is also remembered by hasError().
+  bool flush();
+
+  // Returns the output buffered so far (all output, for in-memory writers)
+  string_view getContents() { return string_view(myBuffer.data(), myUsed); };
+
+  // Discards the buffered output without writing it, keeping the buffer
+  void clear()              { myUsed = 0; };
+
+  // Returns true if any write to the file descriptor failed
+  bool hasError()           { return myError; };
+
+  // Returns the total number of bytes handed to the file descriptor
+  uint64_t getBytesWritten() { return myBytesWritten; };
+
+  // Default size of the output buffer
+  const static size_t defaultCapacity = 1 << 20;
+
+ private:
+
+  int myFd;
+  FlushPolicy myPolicy;
+  vector<char> myBuffer;
+  size_t myUsed;             // bytes of myBuffer holding output
+  bool myError;
+  uint64_t myBytesWritten;
+
+  // Writes size bytes at data to the file descriptor, retrying short writes
+  bool writeAll(const char *data, size_t size);
+
+  // Makes room for at least n more bytes, flushing or growing the buffer
+  void reserve(size_t n) { if (myUsed + n > myBuffer.size()) makeRoom(n); };
+  void makeRoom(size_t n);
+
+  // OutputWriters own a buffer tied to a descriptor, so they cannot be copied
+  OutputWriter(const OutputWriter&);
+  OutputWriter& operator=(const OutputWriter&);
+
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "PerfCounters.h"
+#include <iomanip>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// Opens the counters, initially stopped and zero
+PerfCounters::PerfCounters() {
+  for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+    myFds[e] = -1;
+    myCounts[e] = myStart[e] = 0;
+  }
+
+#ifdef __linux__
+  const uint32_t types[NUM_PERF_EVENTS] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+  };
+  const uint64_t configs[NUM_PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_MISSES
+  };
+
+  for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[e];
+    attr.config = configs[e];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;   // include threads started while counting
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    myFds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (myFds[e] < 0 && myError.empty())
+      myError = string("perf_event_open: ") + strerror(errno);
+  }
+
+  if (isAvailable())
+    myError = "";
+#else
+  myError = "hardware counters are only supported on Linux";
+#endif
+}
+
+// Closes the counters
+PerfCounters::~PerfCounters() {
+  for (int e = 0; e < NUM_PERF_EVENTS; e++)
+    if (myFds[e] >= 0)
+      close(myFds[e]);
+}
+
+// Returns true if at least one event could be counted
+bool PerfCounters::isAvailable() {
+  for (int e = 0; e < NUM_PERF_EVENTS; e++)
+    if (myFds[e] >= 0)
+      return true;
+  return false;
+}
+
+// Starts counting
+void PerfCounters::start() {
+#ifdef __linux__
+  for (int e = 0; e < NUM_PERF_EVENTS; e++)
+    if (myFds[e] >= 0) {
+      myStart[e] = readCounter(myFds[e]);
+      ioctl(myFds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+// Stops counting and adds the events since start() to the totals
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (int e = 0; e < NUM_PERF_EVENTS; e++)
+    if (myFds[e] >= 0) {
+      ioctl(myFds[e], PERF_EVENT_IOC_DISABLE, 0);
+      myCounts[e] += readCounter(myFds[e]) - myStart[e];
+    }
+#endif
+}
+
+// Returns the current value of an open counter, scaled for multiplexing
+uint64_t PerfCounters::readCounter(int fd) {
+  uint64_t values[3];  // value, time enabled, time running
+  if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values))
+    return 0;
+
+  if (values[2] == 0 || values[2] >= values[1])
+    return values[0];
+  return (uint64_t)((double)values[0] * values[1] / values[2]);
+}
+
+// Returns a short name for an event
+const char *PerfCounters::getEventName(PerfEvent e) {
+  static const char *names[NUM_PERF_EVENTS] = {
+    "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+  };
+  return names[e];
+}
+
+// Prints the totals as ratios per decoded instruction, labelled with label
+void PerfCounters::report(ostream& out, string label, uint64_t numInstructions) {
+  out << left << setw(10) << label << right;
+  if (!isAvailable()) {
+    out << " hardware counters unavailable (" << myError << ")" << endl;
+    return;
+  }
+  if (numInstructions == 0)
+    numInstructions = 1;
+
+  out << fixed << setprecision(2);
+  for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+    out << "  " << getEventName((PerfEvent)e) << "/inst ";
+    if (hasEvent((PerfEvent)e))
+      out << setw(8) << (double)myCounts[e] / numInstructions;
+    else
+      out << setw(8) << "n/a";
+  }
+  if (hasEvent(PERF_CYCLES) && hasEvent(PERF_INSTRUCTIONS) && myCounts[PERF_CYCLES] > 0)
+    out << "  IPC " << (double)myCounts[PERF_INSTRUCTIONS] / myCounts[PERF_CYCLES];
+  out << endl;
+}
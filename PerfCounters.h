@@ -0,0 +1,79 @@
+#ifndef __PERFCOUNTERS_H__
+#define __PERFCOUNTERS_H__
+
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+// Hardware events counted by PerfCounters
+enum PerfEvent {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_BRANCH_MISSES,
+  PERF_L1D_MISSES,      // L1 data cache read misses
+  PERF_LLC_MISSES,      // last level cache misses
+  NUM_PERF_EVENTS
+};
+
+/* This class counts hardware events for the calling thread with Linux
+ * perf_event_open, accumulating them over any number of start()/stop()
+ * intervals.  Each event is opened separately, so an event the CPU or
+ * kernel does not offer is simply left out; if the kernel denies access
+ * altogether (perf_event_paranoid, containers, non-Linux systems) the
+ * counters report themselves unavailable and every count stays zero.
+ * Threads started while counting are included once they exit.  Counts
+ * are scaled when the kernel had to multiplex the counters.
+ */
+class PerfCounters {
+
+ public:
+
+  // Opens the counters, initially stopped and zero
+  PerfCounters();
+
+  // Closes the counters
+  ~PerfCounters();
+
+  // Returns true if at least one event could be counted
+  bool isAvailable();
+
+  // Returns true if the given event is being counted
+  bool hasEvent(PerfEvent e)  { return myFds[e] >= 0; };
+
+  // Returns why counting is unavailable, or an empty string
+  string getError()           { return myError; };
+
+  // Starts counting
+  void start();
+
+  // Stops counting and adds the events since start() to the totals
+  void stop();
+
+  // Returns the total count of an event over all start()/stop() intervals
+  uint64_t getCount(PerfEvent e) { return myCounts[e]; };
+
+  // Prints the totals as ratios per decoded instruction, labelled with label
+  void report(ostream& out, string label, uint64_t numInstructions);
+
+  // Returns a short name for an event
+  static const char *getEventName(PerfEvent e);
+
+ private:
+
+  int myFds[NUM_PERF_EVENTS];        // -1 for events that could not be opened
+  uint64_t myCounts[NUM_PERF_EVENTS];
+  uint64_t myStart[NUM_PERF_EVENTS]; // scaled values at start()
+  string myError;
+
+  // Returns the current value of an open counter, scaled for multiplexing
+  uint64_t readCounter(int fd);
+
+  // PerfCounters own file descriptors, so they cannot be copied
+  PerfCounters(const PerfCounters&);
+  PerfCounters& operator=(const PerfCounters&);
+
+};
+
+#endif
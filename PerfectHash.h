@@ -0,0 +1,83 @@
+#ifndef __PERFECTHASH_H__
+#define __PERFECTHASH_H__
+
+#include <string_view>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// A name and the small integer it stands for
+struct NameEntry {
+  string_view name;
+  int value = 0;
+};
+
+/* This class maps a fixed set of names (register names, mnemonics) to
+ * integers with a perfect hash built at compile time: the constructor
+ * searches for a seed under which every name has a slot of its own, so a
+ * lookup is one hash of the name and one comparison.  Size is the number of
+ * slots, a power of two; tables are declared constexpr, and isPerfect()
+ * should be checked with a static_assert.
+ */
+template <size_t Size>
+class PerfectHash {
+
+ public:
+
+  // Builds the table for entries.  Names not in entries look up as missing.
+  template <size_t N>
+  constexpr PerfectHash(const NameEntry (&entries)[N], int missing)
+    : mySlots(), mySeed(0), myMissing(missing) {
+    static_assert((Size & (Size - 1)) == 0, "PerfectHash size must be a power of two");
+    static_assert(N <= Size, "PerfectHash has fewer slots than names");
+
+    for (uint32_t seed = 1; seed <= maxSeed; seed++)
+      if (fill(entries, N, seed)) {
+        mySeed = seed;
+        break;
+      }
+  }
+
+  // Returns the value of name, or the missing value if it is not in the table
+  constexpr int lookup(string_view name) const {
+    const NameEntry& slot = mySlots[slotFor(mySeed, name)];
+    return slot.name == name ? slot.value : myMissing;
+  }
+
+  // Returns true if a seed giving every name its own slot was found
+  constexpr bool isPerfect() const { return mySeed != 0; }
+
+ private:
+
+  const static uint32_t maxSeed = 1 << 16;  // seeds tried before giving up
+
+  NameEntry mySlots[Size];
+  uint32_t mySeed;
+  int myMissing;
+
+  // Returns the slot of name under seed (FNV-1a, with the high bits folded in)
+  static constexpr size_t slotFor(uint32_t seed, string_view name) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : name)
+      h = (h ^ (unsigned char)c) * 16777619u;
+    return (h ^ (h >> 16)) & (Size - 1);
+  }
+
+  // Places every entry under seed.  Returns false if two entries collide.
+  constexpr bool fill(const NameEntry *entries, size_t count, uint32_t seed) {
+    for (size_t n = 0; n < Size; n++)
+      mySlots[n] = NameEntry{ string_view(), myMissing };
+
+    for (size_t n = 0; n < count; n++) {
+      NameEntry& slot = mySlots[slotFor(seed, entries[n].name)];
+      if (!slot.name.empty())
+        return false;
+      slot = entries[n];
+    }
+    return true;
+  }
+
+};
+
+#endif
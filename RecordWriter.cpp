@@ -0,0 +1,206 @@
+#include "RecordWriter.h"
+#include <string.h>
+
+// The name of each InstType, as written in records
+static const char *const typeNames[] = { "R", "I", "J" };
+
+// The fields of a CSV row, in order
+static const char csvHeader[] = "word,mnemonic,type,rs,rt,rd,shamt,imm,offset,target";
+
+// The CSV fields, indexed the same way
+enum RecordField { FIELD_RS, FIELD_RT, FIELD_RD, FIELD_SHAMT, FIELD_IMM, FIELD_OFFSET,
+                   FIELD_TARGET, NUM_FIELDS };
+
+static const char *const fieldNames[NUM_FIELDS] =
+  { "rs", "rt", "rd", "shamt", "imm", "offset", "target" };
+
+// Gives the fields operand kind of instruction i fills in.  Every kind
+// fills one field, except a memory operand, which fills imm and rs.
+static int operandFields(OperandKind kind, const Instruction& i, RecordField fields[2],
+                         int64_t values[2]) {
+  switch (kind) {
+    case OPERAND_RS:
+      fields[0] = FIELD_RS; values[0] = i.getRSNum(); return 1;
+    case OPERAND_RT:
+      fields[0] = FIELD_RT; values[0] = i.getRTNum(); return 1;
+    case OPERAND_RD:
+      fields[0] = FIELD_RD; values[0] = i.getRDNum(); return 1;
+    case OPERAND_SHAMT:
+      fields[0] = FIELD_SHAMT; values[0] = i.getImmediate(); return 1;
+    case OPERAND_IMM:
+    case OPERAND_UIMM:
+      fields[0] = FIELD_IMM; values[0] = i.getImmediate(); return 1;
+    case OPERAND_BRANCH:
+      fields[0] = FIELD_OFFSET; values[0] = (int64_t)i.getImmediate() * 4; return 1;
+    case OPERAND_TARGET:
+      fields[0] = FIELD_TARGET; values[0] = (uint32_t)i.getImmediate() * 4; return 1;
+    case OPERAND_MEMORY:
+      fields[0] = FIELD_IMM; values[0] = i.getImmediate();
+      fields[1] = FIELD_RS; values[1] = i.getRSNum();
+      return 2;
+    case OPERAND_NONE:
+      break;
+  }
+  return 0;
+}
+
+// Creates a writer of records in format (not TEXT_OUTPUT) to out
+RecordWriter::RecordWriter(OutputWriter& out, OutputFormat format) : myOut(out) {
+  myFormat = format;
+}
+
+// This function parses an output format name ("text", "jsonl", "csv" or
+// "columnar").  Returns false if name is not one of them.
+bool RecordWriter::parseFormat(string name, OutputFormat& format) {
+  if (name == "text")
+    format = TEXT_OUTPUT;
+  else if (name == "jsonl")
+    format = JSONL_OUTPUT;
+  else if (name == "csv")
+    format = CSV_OUTPUT;
+  else if (name == "columnar")
+    format = COLUMNAR_OUTPUT;
+  else
+    return false;
+  return true;
+}
+
+// This function writes what comes before the first record: the CSV
+// header row, and nothing for JSON Lines
+void RecordWriter::writeHeader() {
+  if (myFormat == CSV_OUTPUT) {
+    myOut.append(csvHeader);
+    myOut.endLine();
+  }
+}
+
+// This function writes one Instruction as a JSON Lines or CSV record
+void RecordWriter::write(const Instruction& i) {
+  Opcode opcode = i.getOpcode();
+  if (opcode == UNDEFINED)
+    return;
+  const OpcodeSpec& spec = opcodes.getSpec(opcode);
+
+  RecordField fields[2];
+  int64_t values[2];
+
+  if (myFormat == JSONL_OUTPUT) {
+    myOut.append("{\"word\":");
+    myOut.appendDecimal(i.getWord());
+    myOut.append(",\"mnemonic\":\"");
+    myOut.append(spec.name);
+    myOut.append("\",\"type\":\"");
+    myOut.append(typeNames[spec.instType]);
+    myOut.append('"');
+    for (int n = 0; n < maxOperands && spec.operands[n] != OPERAND_NONE; n++) {
+      int count = operandFields(spec.operands[n], i, fields, values);
+      for (int f = 0; f < count; f++) {
+        myOut.append(",\"");
+        myOut.append(fieldNames[fields[f]]);
+        myOut.append("\":");
+        myOut.appendDecimal(values[f]);
+      }
+    }
+    myOut.append('}');
+    myOut.endLine();
+    return;
+  }
+
+  // CSV: every field has a column, empty if the instruction lacks it
+  bool present[NUM_FIELDS] = {};
+  int64_t row[NUM_FIELDS];
+  for (int n = 0; n < maxOperands && spec.operands[n] != OPERAND_NONE; n++) {
+    int count = operandFields(spec.operands[n], i, fields, values);
+    for (int f = 0; f < count; f++) {
+      present[fields[f]] = true;
+      row[fields[f]] = values[f];
+    }
+  }
+
+  myOut.appendDecimal(i.getWord());
+  myOut.append(',');
+  myOut.append(spec.name);
+  myOut.append(',');
+  myOut.append(typeNames[spec.instType]);
+  for (int f = 0; f < NUM_FIELDS; f++) {
+    myOut.append(',');
+    if (present[f])
+      myOut.appendDecimal(row[f]);
+  }
+  myOut.endLine();
+}
+
+// This function writes every Instruction in instructions: the header and
+// a record for each, or the whole columnar file
+void RecordWriter::writeAll(const vector<Instruction>& instructions) {
+  if (myFormat == COLUMNAR_OUTPUT) {
+    writeColumnar(instructions);
+    return;
+  }
+
+  writeHeader();
+  for (const Instruction& i : instructions)
+    write(i);
+}
+
+// This function writes instructions in the columnar format
+void RecordWriter::writeColumnar(const vector<Instruction>& instructions) {
+  const int numColumns = 7;
+  const char *names[numColumns] = { "word", "opcode", "type", "rs", "rt", "rd", "imm" };
+  const int sizes[numColumns] = { 4, 1, 1, 1, 1, 1, 4 };
+  const uint64_t count = instructions.size();
+
+  // Each column starts on an 8 byte boundary after the header and tables
+  uint64_t offsets[numColumns];
+  uint64_t offset = 24 + 24 * numColumns + 8 * UNDEFINED;
+  for (int c = 0; c < numColumns; c++) {
+    offsets[c] = offset;
+    offset += (count * sizes[c] + 7) & ~(uint64_t)7;
+  }
+
+  myOut.append(string_view("MIPSCOL1", 8));
+  appendLittleEndian(count, 8);
+  appendLittleEndian(numColumns, 4);
+  appendLittleEndian(UNDEFINED, 4);
+
+  char name[8];
+  for (int c = 0; c < numColumns; c++) {
+    memset(name, 0, sizeof(name));
+    memcpy(name, names[c], strlen(names[c]));
+    myOut.append(string_view(name, sizeof(name)));
+    appendLittleEndian(sizes[c], 4);
+    appendLittleEndian(0, 4);
+    appendLittleEndian(offsets[c], 8);
+  }
+  for (int o = 0; o < UNDEFINED; o++) {
+    string_view mnemonic = opcodes.getOpcodeName((Opcode)o);
+    memset(name, 0, sizeof(name));
+    memcpy(name, mnemonic.data(), mnemonic.length() < 8 ? mnemonic.length() : 7);
+    myOut.append(string_view(name, sizeof(name)));
+  }
+
+  // The columns, one pass over the instructions each
+  for (int c = 0; c < numColumns; c++) {
+    for (const Instruction& i : instructions) {
+      switch (c) {
+        case 0: appendLittleEndian(i.getWord(), 4); break;
+        case 1: appendLittleEndian(i.getOpcode(), 1); break;
+        case 2: appendLittleEndian(opcodes.getInstType(i.getOpcode()), 1); break;
+        case 3: appendLittleEndian(i.getRSNum(), 1); break;
+        case 4: appendLittleEndian(i.getRTNum(), 1); break;
+        case 5: appendLittleEndian(i.getRDNum(), 1); break;
+        case 6: appendLittleEndian((uint32_t)i.getImmediate(), 4); break;
+      }
+    }
+    for (uint64_t pad = count * sizes[c]; pad % 8 != 0; pad++)
+      myOut.append('\0');
+  }
+}
+
+// This function appends the low size bytes of value, least significant first
+void RecordWriter::appendLittleEndian(uint64_t value, int size) {
+  char bytes[8];
+  for (int b = 0; b < size; b++)
+    bytes[b] = (char)(value >> (8 * b));
+  myOut.append(string_view(bytes, size));
+}
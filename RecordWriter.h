@@ -0,0 +1,87 @@
+#ifndef __RECORDWRITER_H__
+#define __RECORDWRITER_H__
+
+#include "Instruction.h"
+#include "OpcodeTable.h"
+#include "OutputWriter.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Layouts of Binary's output
+enum OutputFormat {
+  TEXT_OUTPUT,      // "encoding<tab>assembly" lines
+  JSONL_OUTPUT,     // one JSON object per instruction, one per line
+  CSV_OUTPUT,       // a header row, then one row per instruction
+  COLUMNAR_OUTPUT   // a binary file holding one array per field
+};
+
+/* This class writes decoded Instructions as records for other programs to
+ * load, straight from their fields, without formatting assembly text.
+ *
+ * JSON Lines and CSV records hold the word, the mnemonic, the type (R, I
+ * or J) and one field per operand the instruction has, named after its
+ * kind: "rs", "rt" and "rd" (register numbers), "shamt", "imm" (the
+ * immediate, sign extended except for andi/ori/xori/lui; for loads and
+ * stores the displacement from rs), "offset" (a branch's byte offset) and
+ * "target" (a jump's byte address).  A JSON object only has the fields
+ * its instruction uses; a CSV row leaves the others empty.
+ *
+ * The columnar format is little-endian and laid out to be mapped and used
+ * in place:
+ *
+ *   offset 0   char[8]   magic "MIPSCOL1"
+ *          8   uint64    number of instructions, n
+ *         16   uint32    number of columns, c
+ *         20   uint32    number of opcodes, m
+ *         24   c entries of 24 bytes: char[8] name (NUL padded),
+ *              uint32 element size, uint32 0, uint64 offset of the column
+ *              then m opcode mnemonics, char[8] each (NUL padded)
+ *   the columns, each an array of n elements starting on an 8 byte boundary:
+ *     "word"    uint32   the instruction word
+ *     "opcode"  uint8    index of its mnemonic in the table above
+ *     "type"    uint8    0 for R, 1 for I, 2 for J
+ *     "rs", "rt", "rd"   uint8   register numbers, 32 if not used
+ *     "imm"     int32    the immediate field as decoded: sign extended (or
+ *                        not, as above), the shift amount, or the word
+ *                        offset or index of a branch or jump
+ */
+class RecordWriter {
+
+ public:
+
+  // Creates a writer of records in format (not TEXT_OUTPUT) to out
+  RecordWriter(OutputWriter& out, OutputFormat format);
+
+  // This function parses an output format name ("text", "jsonl", "csv" or
+  // "columnar").  Returns false if name is not one of them.
+  static bool parseFormat(string name, OutputFormat& format);
+
+  // This function writes what comes before the first record: the CSV
+  // header row, and nothing for JSON Lines
+  void writeHeader();
+
+  // This function writes one Instruction as a JSON Lines or CSV record
+  void write(const Instruction& i);
+
+  // This function writes every Instruction in instructions: the header and
+  // a record for each, or the whole columnar file
+  void writeAll(const vector<Instruction>& instructions);
+
+ private:
+
+  OutputWriter& myOut;
+  OutputFormat myFormat;
+  OpcodeTable opcodes;
+
+  // This function writes instructions in the columnar format
+  void writeColumnar(const vector<Instruction>& instructions);
+
+  // This function appends the low size bytes of value, least significant first
+  void appendLittleEndian(uint64_t value, int size);
+
+};
+
+#endif
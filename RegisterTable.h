@@ -1,39 +1,66 @@
 #ifndef _REGISTERTABLE_H
 #define _REGISTERTABLE_H
 
+#include "PerfectHash.h"
 #include <string>
+#include <string_view>
 
 using namespace std;
 
 typedef string Register;
 const int NumRegisters = 32;
 
-// Each register has a number and a string name
-struct RegisterEntry {
-  Register name;
-  int number;
+// The names a register can be written with: its number ("$8") and its
+// ABI name ("$t0"), each with the register number
+inline constexpr NameEntry registerNames[2 * NumRegisters] = {
+  { "$0", 0 },   { "$1", 1 },   { "$2", 2 },   { "$3", 3 },
+  { "$4", 4 },   { "$5", 5 },   { "$6", 6 },   { "$7", 7 },
+  { "$8", 8 },   { "$9", 9 },   { "$10", 10 }, { "$11", 11 },
+  { "$12", 12 }, { "$13", 13 }, { "$14", 14 }, { "$15", 15 },
+  { "$16", 16 }, { "$17", 17 }, { "$18", 18 }, { "$19", 19 },
+  { "$20", 20 }, { "$21", 21 }, { "$22", 22 }, { "$23", 23 },
+  { "$24", 24 }, { "$25", 25 }, { "$26", 26 }, { "$27", 27 },
+  { "$28", 28 }, { "$29", 29 }, { "$30", 30 }, { "$31", 31 },
+
+  { "$zero", 0 }, { "$at", 1 },  { "$v0", 2 },  { "$v1", 3 },
+  { "$a0", 4 },   { "$a1", 5 },  { "$a2", 6 },  { "$a3", 7 },
+  { "$t0", 8 },   { "$t1", 9 },  { "$t2", 10 }, { "$t3", 11 },
+  { "$t4", 12 },  { "$t5", 13 }, { "$t6", 14 }, { "$t7", 15 },
+  { "$s0", 16 },  { "$s1", 17 }, { "$s2", 18 }, { "$s3", 19 },
+  { "$s4", 20 },  { "$s5", 21 }, { "$s6", 22 }, { "$s7", 23 },
+  { "$t8", 24 },  { "$t9", 25 }, { "$k0", 26 }, { "$k1", 27 },
+  { "$gp", 28 },  { "$sp", 29 }, { "$fp", 30 }, { "$ra", 31 },
 };
 
+// Register name to number lookup, built at compile time
+inline constexpr PerfectHash<256> registerNumbers(registerNames, NumRegisters);
+
+static_assert(registerNumbers.isPerfect(), "no perfect hash found for the register names");
+static_assert(registerNumbers.lookup("$t0") == 8 && registerNumbers.lookup("$32") == NumRegisters,
+              "register name lookup is wrong");
+
 /* This class stores information about the valid register names for MIPS.
+ * The names are constexpr data (registerNames), so a RegisterTable holds
+ * nothing and costs nothing to create.
  */
 class RegisterTable {
 
  public:
-  // Constructs and initializes the valid register names and numbers
-  RegisterTable();
 
   // Given an int representing a MIPS register operand, returns the name associated
   // with that register.  If int is not a valid register, returns an empty string.
-  string getName(int registerNumber);
+  static constexpr string_view getName(int registerNumber) {
+    if (registerNumber < 0 || registerNumber >= NumRegisters)
+      return string_view();
+    return registerNames[registerNumber].name;
+  }
 
   // Given a string representing a MIPS register operand, returns the number associated
   // with that register.  If string is not a valid register, returns NumRegisters.
-  int getNum(string registerName);
-
- private:
-
-  RegisterEntry myRegisters[64];
+  static constexpr int getNum(string_view registerName) {
+    return registerNumbers.lookup(registerName);
+  }
 
 };
 
-#endif
\ No newline at end of file
+#endif
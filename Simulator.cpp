@@ -0,0 +1,332 @@
+#include "Simulator.h"
+#include <algorithm>
+#include <string.h>
+
+// Creates a simulator with memorySize bytes of zeroed memory (rounded up
+// to a multiple of 4, at least 4), all registers 0 except $sp, which
+// points at the top of memory
+Simulator::Simulator(size_t memorySize) {
+  myMemory.assign(max((memorySize + 3) & ~(size_t)3, (size_t)4), 0);
+  for (int reg = 0; reg < NumRegisters; reg++)
+    myRegisters[reg] = 0;
+  myRegisters[29] = (uint32_t)myMemory.size();
+  myHI = myLO = 0;
+  myExecuted = 0;
+  myNext = 0;
+  myLinked = false;
+}
+
+// Returns or sets register reg (0 to 31); $0 always reads as 0
+void Simulator::setRegister(int reg, uint32_t value) {
+  if (reg > 0 && reg < NumRegisters)
+    myRegisters[reg] = value;
+}
+
+// Loads count instructions as the program, starting at textBase, and
+// sets the PC to its first instruction.  UNDEFINED Instructions are kept
+// in place and stop the simulation with STOP_RESERVED when reached.
+void Simulator::load(const Instruction *program, size_t count) {
+  myCode.assign(count + 1, Operation());
+  for (size_t n = 0; n < count; n++) {
+    const Instruction& i = program[n];
+    Operation& op = myCode[n];
+    op.handler = NULL;
+    op.opcode = i.getOpcode();
+    op.rs = i.getRSNum() < NumRegisters ? i.getRSNum() : 0;
+    op.rt = i.getRTNum() < NumRegisters ? i.getRTNum() : 0;
+    op.rd = i.getRDNum() < NumRegisters ? i.getRDNum() : 0;
+    op.imm = i.getImmediate();
+
+    // There is no isaSpec entry for UNDEFINED, so it is trapped here
+    if (op.opcode >= UNDEFINED) {
+      op.opcode = reservedOpcode;
+      op.imm = 0;
+      continue;
+    }
+
+    // Branch and jump targets become indexes into myCode, or -1 if they
+    // are outside the program (reported when the branch is taken)
+    OperandKind kind = isaSpec[op.opcode].immediateKind();
+    int64_t target = -1;
+    if (kind == OPERAND_BRANCH)
+      target = (int64_t)n + 1 + op.imm;
+    else if (kind == OPERAND_TARGET) {
+      uint32_t next = textBase + 4 * (uint32_t)(n + 1);
+      uint32_t address = (next & 0xf0000000) | ((uint32_t)op.imm << 2);
+      if (address >= textBase)
+        target = (address - textBase) / 4;
+    }
+    if (kind == OPERAND_BRANCH || kind == OPERAND_TARGET)
+      op.imm = (target >= 0 && target <= (int64_t)count) ? (int32_t)target : -1;
+  }
+
+  // The end marker
+  myCode[count].handler = NULL;
+  myCode[count].opcode = UNDEFINED;
+
+  myLinked = false;
+  myNext = 0;
+}
+
+// Big-endian memory access helpers
+static uint32_t loadWord(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void storeWord(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+// Runs from the current PC until the program stops or maxSteps
+// instructions have been executed, and returns the reason it stopped.
+// The PC is left at the instruction that stopped it, or just past it for
+// syscall and break so that run() can be called again to continue.
+StopReason Simulator::run(uint64_t maxSteps) {
+  // Handler of every Opcode; the end marker has the Opcode UNDEFINED
+  const void *labels[reservedOpcode + 1];
+  labels[ADD] = &&op_ADD;         labels[ADDI] = &&op_ADDI;
+  labels[XOR] = &&op_XOR;         labels[MULT] = &&op_MULT;
+  labels[MFLO] = &&op_MFLO;       labels[SLL] = &&op_SLL;
+  labels[SLT] = &&op_SLT;         labels[SLTI] = &&op_SLTI;
+  labels[LB] = &&op_LB;           labels[J] = &&op_J;
+  labels[BEQ] = &&op_BEQ;         labels[SRL] = &&op_SRL;
+  labels[SRA] = &&op_SRA;         labels[SLLV] = &&op_SLLV;
+  labels[SRLV] = &&op_SRLV;       labels[SRAV] = &&op_SRAV;
+  labels[JR] = &&op_JR;           labels[JALR] = &&op_JALR;
+  labels[SYSCALL] = &&op_SYSCALL; labels[BREAK] = &&op_BREAK;
+  labels[MFHI] = &&op_MFHI;       labels[MTHI] = &&op_MTHI;
+  labels[MTLO] = &&op_MTLO;       labels[MULTU] = &&op_MULTU;
+  labels[DIV] = &&op_DIV;         labels[DIVU] = &&op_DIVU;
+  labels[ADDU] = &&op_ADDU;       labels[SUB] = &&op_SUB;
+  labels[SUBU] = &&op_SUBU;       labels[AND] = &&op_AND;
+  labels[OR] = &&op_OR;           labels[NOR] = &&op_NOR;
+  labels[SLTU] = &&op_SLTU;       labels[BLTZ] = &&op_BLTZ;
+  labels[BGEZ] = &&op_BGEZ;       labels[BLTZAL] = &&op_BLTZAL;
+  labels[BGEZAL] = &&op_BGEZAL;   labels[JAL] = &&op_JAL;
+  labels[BNE] = &&op_BNE;         labels[BLEZ] = &&op_BLEZ;
+  labels[BGTZ] = &&op_BGTZ;       labels[ADDIU] = &&op_ADDIU;
+  labels[SLTIU] = &&op_SLTIU;     labels[ANDI] = &&op_ANDI;
+  labels[ORI] = &&op_ORI;         labels[XORI] = &&op_XORI;
+  labels[LUI] = &&op_LUI;         labels[LH] = &&op_LH;
+  labels[LWL] = &&op_LWL;         labels[LW] = &&op_LW;
+  labels[LBU] = &&op_LBU;         labels[LHU] = &&op_LHU;
+  labels[LWR] = &&op_LWR;         labels[SB] = &&op_SB;
+  labels[SH] = &&op_SH;           labels[SWL] = &&op_SWL;
+  labels[SW] = &&op_SW;           labels[SWR] = &&op_SWR;
+  labels[UNDEFINED] = &&op_END;
+  labels[reservedOpcode] = &&op_RESERVED;
+
+  if (!myLinked) {
+    for (Operation& op : myCode)
+      op.handler = labels[op.opcode];
+    myLinked = true;
+  }
+
+  // Work on local copies of the machine state
+  uint32_t r[NumRegisters];
+  memcpy(r, myRegisters, sizeof(r));
+  uint32_t hi = myHI, lo = myLO;
+  uint8_t *mem = myMemory.data();
+  const uint32_t memSize = myMemory.size();
+  const Operation *code = myCode.data();
+  const Operation *op = code + myNext;
+  uint64_t executed = 0;
+  StopReason reason = STOP_END;
+  uint32_t address;
+  int64_t wide;
+
+// Starts the operation at op; $0 is cleared in case the last one wrote it
+#define DISPATCH() do { r[0] = 0; if (executed == maxSteps) goto stepLimit; \
+                        executed++; goto *op->handler; } while (0)
+#define NEXT() do { op++; DISPATCH(); } while (0)
+
+// Continues at the operation with index target, if it is in the program
+#define JUMP(target) do { if ((target) < 0) goto badPC; op = code + (target); DISPATCH(); } while (0)
+
+// Continues at a computed byte address
+#define JUMP_ADDRESS(a) do { uint32_t to = (a); \
+    if (to < textBase || (to - textBase) % 4 != 0 || (to - textBase) / 4 >= myCode.size()) goto badPC; \
+    op = code + (to - textBase) / 4; DISPATCH(); } while (0)
+
+// Sets address to rs + imm, checking it is in memory and a multiple of size
+#define ADDRESS(size) do { address = r[op->rs] + (uint32_t)op->imm; \
+    if (address > memSize - (size) || address % (size) != 0) goto badAddress; } while (0)
+
+// The return address of the current operation
+#define LINK() (textBase + 4 * (uint32_t)(op - code + 1))
+
+#define S(x) ((int32_t)(x))
+
+  DISPATCH();
+
+  // Arithmetic and logic
+op_ADD:
+  { int32_t sum; if (__builtin_add_overflow(S(r[op->rs]), S(r[op->rt]), &sum)) goto overflow;
+    r[op->rd] = sum; } NEXT();
+op_ADDI:
+  { int32_t sum; if (__builtin_add_overflow(S(r[op->rs]), op->imm, &sum)) goto overflow;
+    r[op->rt] = sum; } NEXT();
+op_SUB:
+  { int32_t diff; if (__builtin_sub_overflow(S(r[op->rs]), S(r[op->rt]), &diff)) goto overflow;
+    r[op->rd] = diff; } NEXT();
+op_ADDU:  r[op->rd] = r[op->rs] + r[op->rt]; NEXT();
+op_SUBU:  r[op->rd] = r[op->rs] - r[op->rt]; NEXT();
+op_ADDIU: r[op->rt] = r[op->rs] + (uint32_t)op->imm; NEXT();
+op_AND:   r[op->rd] = r[op->rs] & r[op->rt]; NEXT();
+op_OR:    r[op->rd] = r[op->rs] | r[op->rt]; NEXT();
+op_XOR:   r[op->rd] = r[op->rs] ^ r[op->rt]; NEXT();
+op_NOR:   r[op->rd] = ~(r[op->rs] | r[op->rt]); NEXT();
+op_ANDI:  r[op->rt] = r[op->rs] & (uint32_t)op->imm; NEXT();
+op_ORI:   r[op->rt] = r[op->rs] | (uint32_t)op->imm; NEXT();
+op_XORI:  r[op->rt] = r[op->rs] ^ (uint32_t)op->imm; NEXT();
+op_LUI:   r[op->rt] = (uint32_t)op->imm << 16; NEXT();
+op_SLT:   r[op->rd] = S(r[op->rs]) < S(r[op->rt]); NEXT();
+op_SLTU:  r[op->rd] = r[op->rs] < r[op->rt]; NEXT();
+op_SLTI:  r[op->rt] = S(r[op->rs]) < op->imm; NEXT();
+op_SLTIU: r[op->rt] = r[op->rs] < (uint32_t)op->imm; NEXT();
+
+  // Shifts
+op_SLL:   r[op->rd] = r[op->rt] << op->imm; NEXT();
+op_SRL:   r[op->rd] = r[op->rt] >> op->imm; NEXT();
+op_SRA:   r[op->rd] = S(r[op->rt]) >> op->imm; NEXT();
+op_SLLV:  r[op->rd] = r[op->rt] << (r[op->rs] & 31); NEXT();
+op_SRLV:  r[op->rd] = r[op->rt] >> (r[op->rs] & 31); NEXT();
+op_SRAV:  r[op->rd] = S(r[op->rt]) >> (r[op->rs] & 31); NEXT();
+
+  // Multiply and divide, through HI and LO.  Division by zero leaves them
+  // unchanged (the result is unpredictable on hardware).
+op_MULT:
+  wide = (int64_t)S(r[op->rs]) * S(r[op->rt]);
+  hi = (uint64_t)wide >> 32; lo = (uint32_t)wide; NEXT();
+op_MULTU:
+  wide = (int64_t)((uint64_t)r[op->rs] * r[op->rt]);
+  hi = (uint64_t)wide >> 32; lo = (uint32_t)wide; NEXT();
+op_DIV:
+  if (r[op->rt] != 0) {
+    if (S(r[op->rs]) == INT32_MIN && S(r[op->rt]) == -1) { lo = r[op->rs]; hi = 0; }
+    else { lo = S(r[op->rs]) / S(r[op->rt]); hi = S(r[op->rs]) % S(r[op->rt]); }
+  }
+  NEXT();
+op_DIVU:
+  if (r[op->rt] != 0) { lo = r[op->rs] / r[op->rt]; hi = r[op->rs] % r[op->rt]; }
+  NEXT();
+op_MFHI:  r[op->rd] = hi; NEXT();
+op_MFLO:  r[op->rd] = lo; NEXT();
+op_MTHI:  hi = r[op->rs]; NEXT();
+op_MTLO:  lo = r[op->rs]; NEXT();
+
+  // Loads and stores
+op_LB:    ADDRESS(1); r[op->rt] = (int8_t)mem[address]; NEXT();
+op_LBU:   ADDRESS(1); r[op->rt] = mem[address]; NEXT();
+op_LH:    ADDRESS(2); r[op->rt] = (int16_t)((mem[address] << 8) | mem[address + 1]); NEXT();
+op_LHU:   ADDRESS(2); r[op->rt] = (mem[address] << 8) | mem[address + 1]; NEXT();
+op_LW:    ADDRESS(4); r[op->rt] = loadWord(mem + address); NEXT();
+op_SB:    ADDRESS(1); mem[address] = r[op->rt]; NEXT();
+op_SH:    ADDRESS(2); mem[address] = r[op->rt] >> 8; mem[address + 1] = r[op->rt]; NEXT();
+op_SW:    ADDRESS(4); storeWord(mem + address, r[op->rt]); NEXT();
+
+  // Unaligned word access: the bytes from address to the end (lwl/swl) or
+  // start (lwr/swr) of its aligned word
+op_LWL:
+  { ADDRESS(1); uint32_t shift = 8 * (address & 3);
+    uint32_t word = loadWord(mem + (address & ~3u));
+    r[op->rt] = (word << shift) | (r[op->rt] & ((1u << shift) - 1)); } NEXT();
+op_LWR:
+  { ADDRESS(1); uint32_t shift = 8 * (3 - (address & 3));
+    uint32_t word = loadWord(mem + (address & ~3u));
+    r[op->rt] = (word >> shift) | (r[op->rt] & ~(0xffffffffu >> shift)); } NEXT();
+op_SWL:
+  ADDRESS(1);
+  for (uint32_t b = 0; b <= 3 - (address & 3); b++)
+    mem[address + b] = r[op->rt] >> (24 - 8 * b);
+  NEXT();
+op_SWR:
+  ADDRESS(1);
+  for (uint32_t b = 0; b <= (address & 3); b++)
+    mem[address - b] = r[op->rt] >> (8 * b);
+  NEXT();
+
+  // Branches and jumps
+op_BEQ:    if (r[op->rs] == r[op->rt]) JUMP(op->imm); NEXT();
+op_BNE:    if (r[op->rs] != r[op->rt]) JUMP(op->imm); NEXT();
+op_BLEZ:   if (S(r[op->rs]) <= 0) JUMP(op->imm); NEXT();
+op_BGTZ:   if (S(r[op->rs]) > 0) JUMP(op->imm); NEXT();
+op_BLTZ:   if (S(r[op->rs]) < 0) JUMP(op->imm); NEXT();
+op_BGEZ:   if (S(r[op->rs]) >= 0) JUMP(op->imm); NEXT();
+
+  // The link is written whether or not the branch is taken; the condition
+  // is tested first in case rs is $31
+op_BLTZAL: { bool taken = S(r[op->rs]) < 0; r[31] = LINK(); if (taken) JUMP(op->imm); } NEXT();
+op_BGEZAL: { bool taken = S(r[op->rs]) >= 0; r[31] = LINK(); if (taken) JUMP(op->imm); } NEXT();
+op_J:      JUMP(op->imm);
+op_JAL:    r[31] = LINK(); JUMP(op->imm);
+op_JR:     JUMP_ADDRESS(r[op->rs]);
+op_JALR:   { uint32_t base = r[op->rs]; r[op->rd] = LINK(); JUMP_ADDRESS(base); }
+
+  // Stops
+op_SYSCALL:
+  reason = STOP_SYSCALL;
+  op++;
+  goto stopped;
+op_BREAK:
+  reason = STOP_BREAK;
+  op++;
+  goto stopped;
+op_END:
+  executed--;
+  reason = STOP_END;
+  goto stopped;
+op_RESERVED:
+  executed--;
+  reason = STOP_RESERVED;
+  goto stopped;
+stepLimit:
+  reason = STOP_STEP_LIMIT;
+  goto stopped;
+badPC:
+  reason = STOP_BAD_PC;
+  goto stopped;
+badAddress:
+  executed--;
+  reason = STOP_BAD_ADDRESS;
+  goto stopped;
+overflow:
+  executed--;
+  reason = STOP_OVERFLOW;
+  goto stopped;
+
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef JUMP_ADDRESS
+#undef ADDRESS
+#undef LINK
+#undef S
+
+stopped:
+  r[0] = 0;
+  memcpy(myRegisters, r, sizeof(r));
+  myHI = hi;
+  myLO = lo;
+  myNext = op - code;
+  myExecuted += executed;
+  return reason;
+}
+
+// Returns a short description of reason
+string Simulator::getStopDescription(StopReason reason) {
+  switch (reason) {
+    case STOP_END:          return "end of program";
+    case STOP_SYSCALL:      return "syscall";
+    case STOP_BREAK:        return "break";
+    case STOP_STEP_LIMIT:   return "step limit reached";
+    case STOP_BAD_PC:       return "jump outside the program";
+    case STOP_BAD_ADDRESS:  return "bad memory address";
+    case STOP_OVERFLOW:     return "arithmetic overflow";
+    case STOP_RESERVED:     return "reserved instruction";
+  }
+  return "";
+}
@@ -0,0 +1,111 @@
+#ifndef __SIMULATOR_H__
+#define __SIMULATOR_H__
+
+#include "Instruction.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Why a simulation stopped
+enum StopReason {
+  STOP_END,           // ran off the end of the program
+  STOP_SYSCALL,       // executed syscall
+  STOP_BREAK,         // executed break
+  STOP_STEP_LIMIT,    // executed the maximum number of instructions
+  STOP_BAD_PC,        // jumped or branched outside the program
+  STOP_BAD_ADDRESS,   // loaded or stored outside memory, or unaligned
+  STOP_OVERFLOW,      // add, addi or sub overflowed
+  STOP_RESERVED       // reached an instruction that could not be decoded
+};
+
+/* This class executes decoded MIPS instructions.  It holds the register
+ * file, HI and LO, a flat big-endian byte memory starting at address 0 and
+ * the program, which occupies its own text segment at textBase.
+ *
+ * load() translates the Instructions once into a compact array of
+ * pre-decoded operations, and run() executes that array with threaded
+ * dispatch: each operation holds the address of its handler (a GNU
+ * computed goto label) and every handler ends by jumping straight to the
+ * next one, so there is no central switch.  Branches have no delay slot;
+ * the instruction after a taken branch is not executed.  syscall and break
+ * stop the simulation, as does reaching an UNDEFINED Instruction.
+ */
+class Simulator {
+
+ public:
+
+  // Creates a simulator with memorySize bytes of zeroed memory (rounded up
+  // to a multiple of 4, at least 4), all registers 0 except $sp, which
+  // points at the top of memory
+  Simulator(size_t memorySize = defaultMemorySize);
+
+  // Loads count instructions as the program, starting at textBase, and
+  // sets the PC to its first instruction.  UNDEFINED Instructions are kept
+  // in place and stop the simulation with STOP_RESERVED when reached.
+  void load(const Instruction *program, size_t count);
+
+  // Runs from the current PC until the program stops or maxSteps
+  // instructions have been executed, and returns the reason it stopped.
+  // The PC is left at the instruction that stopped it, or just past it for
+  // syscall and break so that run() can be called again to continue.
+  StopReason run(uint64_t maxSteps);
+
+  // Returns the number of instructions executed by all runs so far
+  uint64_t getExecuted()                 { return myExecuted; };
+
+  // Returns the address of the next instruction to execute
+  uint32_t getPC()                       { return textBase + 4 * myNext; };
+
+  // Returns or sets register reg (0 to 31); $0 always reads as 0
+  uint32_t getRegister(int reg)          { return myRegisters[reg]; };
+  void setRegister(int reg, uint32_t value);
+
+  // Returns the HI and LO registers
+  uint32_t getHI()                       { return myHI; };
+  uint32_t getLO()                       { return myLO; };
+
+  // Returns a pointer to the simulated memory and its size in bytes
+  uint8_t *getMemory()                   { return myMemory.data(); };
+  size_t getMemorySize()                 { return myMemory.size(); };
+
+  // Returns a short description of reason
+  static string getStopDescription(StopReason reason);
+
+  // Address of the first instruction of the program
+  const static uint32_t textBase = 0x00400000;
+
+  // Size of the memory of a default simulator
+  const static size_t defaultMemorySize = 1 << 20;
+
+ private:
+
+  // Operation opcode of an UNDEFINED Instruction, which traps when reached
+  const static uint8_t reservedOpcode = UNDEFINED + 1;
+
+  // One pre-decoded instruction.  handler is filled in by run(), which
+  // owns the labels; until then it is NULL.
+  struct Operation {
+    const void *handler;
+    int32_t imm;        // immediate, shift amount, or branch target index
+    uint8_t opcode;     // an Opcode, UNDEFINED for the end of the program,
+                        // or reservedOpcode for an UNDEFINED Instruction
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t rd;
+  };
+
+  vector<Operation> myCode;  // the program, then one end marker
+  bool myLinked;             // true once handlers are filled in
+  size_t myNext;             // index in myCode of the next instruction
+
+  uint32_t myRegisters[NumRegisters];
+  uint32_t myHI;
+  uint32_t myLO;
+  vector<uint8_t> myMemory;
+  uint64_t myExecuted;
+
+};
+
+#endif
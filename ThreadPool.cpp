@@ -0,0 +1,67 @@
+#include "ThreadPool.h"
+
+// Starts numThreads worker threads (at least one)
+ThreadPool::ThreadPool(int numThreads) {
+  myPending = 0;
+  myStopping = false;
+
+  if (numThreads < 1)
+    numThreads = 1;
+
+  for (int i = 0; i < numThreads; i++)
+    myThreads.push_back(thread(&ThreadPool::workerLoop, this));
+}
+
+// Finishes the queued tasks and joins the worker threads
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> lock(myLock);
+    myStopping = true;
+  }
+  myTaskReady.notify_all();
+
+  for (int i = 0; i < (int)myThreads.size(); i++)
+    myThreads[i].join();
+}
+
+// Queues a task to be run by one of the workers
+void ThreadPool::submit(function<void()> task) {
+  {
+    unique_lock<mutex> lock(myLock);
+    myTasks.push(task);
+    myPending++;
+  }
+  myTaskReady.notify_one();
+}
+
+// Blocks until every submitted task has finished
+void ThreadPool::wait() {
+  unique_lock<mutex> lock(myLock);
+  while (myPending > 0)
+    myAllDone.wait(lock);
+}
+
+// Body of each worker thread: runs queued tasks until the pool stops
+void ThreadPool::workerLoop() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock(myLock);
+      while (myTasks.empty() && !myStopping)
+        myTaskReady.wait(lock);
+
+      if (myTasks.empty())
+        return;
+
+      task = myTasks.front();
+      myTasks.pop();
+    }
+
+    task();
+
+    unique_lock<mutex> lock(myLock);
+    myPending--;
+    if (myPending == 0)
+      myAllDone.notify_all();
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+
+using namespace std;
+
+/* This class runs tasks on a fixed set of worker threads.  Tasks are taken
+ * from a shared queue in the order they were submitted; wait() blocks until
+ * every submitted task has finished.
+ */
+class ThreadPool {
+
+ public:
+
+  // Starts numThreads worker threads (at least one)
+  ThreadPool(int numThreads);
+
+  // Finishes the queued tasks and joins the worker threads
+  ~ThreadPool();
+
+  // Queues a task to be run by one of the workers
+  void submit(function<void()> task);
+
+  // Blocks until every submitted task has finished
+  void wait();
+
+  // Returns the number of worker threads
+  int getNumThreads() { return (int)myThreads.size(); };
+
+ private:
+
+  vector<thread> myThreads;
+  queue<function<void()> > myTasks;
+  int myPending;                    // tasks submitted but not yet finished
+  bool myStopping;                  // set when the pool is being destroyed
+
+  mutex myLock;                     // guards myTasks, myPending and myStopping
+  condition_variable myTaskReady;   // signalled when a task is queued or on shutdown
+  condition_variable myAllDone;     // signalled when myPending drops to 0
+
+  // Body of each worker thread: runs queued tasks until the pool stops
+  void workerLoop();
+
+  // ThreadPools own threads, so they cannot be copied
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+};
+
+#endif
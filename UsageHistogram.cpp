@@ -0,0 +1,211 @@
+#include "UsageHistogram.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// How an instruction uses its registers and immediate, worked out from
+// isaSpec at compile time
+struct OpcodeUsage {
+  bool readsRS;
+  bool readsRT;
+  bool writesRT;
+  bool writesRD;
+  bool links;              // writes the return address to $31
+  bool isBranch;
+  bool isJump;
+  OperandKind immediate;   // kind of the immediate operand, or OPERAND_NONE
+};
+
+static constexpr OpcodeUsage usageOf(const OpcodeSpec& spec) {
+  bool isBranch = spec.position(OPERAND_BRANCH) != -1;
+  bool rtRead = spec.instType == RTYPE || isBranch || spec.isStore();
+
+  OpcodeUsage usage = {};
+  usage.readsRS = spec.usesRS();
+  usage.readsRT = spec.usesRT() && rtRead;
+  usage.writesRT = spec.usesRT() && !rtRead;
+  usage.writesRD = spec.usesRD();
+  usage.links = spec.opcode == JAL || spec.opcode == BLTZAL || spec.opcode == BGEZAL;
+  usage.isBranch = isBranch;
+  usage.isJump = spec.position(OPERAND_TARGET) != -1 || spec.opcode == JR || spec.opcode == JALR;
+  usage.immediate = spec.immediateKind();
+  return usage;
+}
+
+template <size_t... O>
+static constexpr array<OpcodeUsage, UNDEFINED> makeUsage(index_sequence<O...>) {
+  return {{ usageOf(isaSpec[O])... }};
+}
+
+// The usage of every Opcode
+static constexpr array<OpcodeUsage, UNDEFINED> opcodeUsage =
+  makeUsage(make_index_sequence<UNDEFINED>());
+
+// Names of the immediate kinds, indexed by OperandKind
+static const char *const immediateNames[OPERAND_MEMORY + 1] = {
+  NULL, NULL, NULL, NULL, "shamt", "imm", "uimm", "branch", "target", "memory"
+};
+
+static const char *const typeNames[3] = { "RTYPE", "ITYPE", "JTYPE" };
+
+// Creates an empty histogram
+UsageHistogram::UsageHistogram() {
+  for (int o = 0; o < UNDEFINED; o++)
+    myOpcodes[o] = 0;
+  for (int r = 0; r < NumRegisters; r++)
+    myReads[r] = myWrites[r] = 0;
+  for (int k = 0; k <= OPERAND_MEMORY; k++)
+    myImmediates[k] = ImmediateRange{ 0, 0, 0, INT64_MAX, INT64_MIN };
+}
+
+// Counts one Instruction; UNDEFINED Instructions are ignored
+void UsageHistogram::add(const Instruction& i) {
+  Opcode opcode = i.getOpcode();
+  if (opcode == UNDEFINED)
+    return;
+
+  myOpcodes[opcode]++;
+  const OpcodeUsage& usage = opcodeUsage[opcode];
+  if (usage.readsRS)
+    myReads[i.getRSNum()]++;
+  if (usage.readsRT)
+    myReads[i.getRTNum()]++;
+  if (usage.writesRT)
+    myWrites[i.getRTNum()]++;
+  if (usage.writesRD)
+    myWrites[i.getRDNum()]++;
+  if (usage.links)
+    myWrites[31]++;
+
+  if (usage.immediate == OPERAND_NONE)
+    return;
+
+  // Branch offsets and jump targets are counted in bytes, as they are printed
+  int64_t value = i.getImmediate();
+  if (usage.immediate == OPERAND_BRANCH)
+    value *= 4;
+  else if (usage.immediate == OPERAND_TARGET)
+    value = (uint32_t)value * 4;
+
+  ImmediateRange& range = myImmediates[usage.immediate];
+  range.count++;
+  range.negative += (value < 0);
+  range.zero += (value == 0);
+  range.min = value < range.min ? value : range.min;
+  range.max = value > range.max ? value : range.max;
+}
+
+// Counts count Instructions starting at instructions
+void UsageHistogram::add(const Instruction *instructions, size_t count) {
+  for (size_t n = 0; n < count; n++)
+    add(instructions[n]);
+}
+
+// Adds the counts of other to this histogram
+void UsageHistogram::merge(const UsageHistogram& other) {
+  for (int o = 0; o < UNDEFINED; o++)
+    myOpcodes[o] += other.myOpcodes[o];
+  for (int r = 0; r < NumRegisters; r++) {
+    myReads[r] += other.myReads[r];
+    myWrites[r] += other.myWrites[r];
+  }
+  for (int k = 0; k <= OPERAND_MEMORY; k++) {
+    ImmediateRange& range = myImmediates[k];
+    const ImmediateRange& add = other.myImmediates[k];
+    range.count += add.count;
+    range.negative += add.negative;
+    range.zero += add.zero;
+    range.min = add.min < range.min ? add.min : range.min;
+    range.max = add.max > range.max ? add.max : range.max;
+  }
+}
+
+// Returns the number of Instructions counted
+uint64_t UsageHistogram::getCount() const {
+  uint64_t count = 0;
+  for (int o = 0; o < UNDEFINED; o++)
+    count += myOpcodes[o];
+  return count;
+}
+
+// Prints the statistics, as a JSON object if json is true
+void UsageHistogram::report(ostream& out, bool json) const {
+  uint64_t count = getCount();
+  uint64_t types[3] = { 0, 0, 0 };
+  uint64_t branches = 0, jumps = 0;
+  for (int o = 0; o < UNDEFINED; o++) {
+    types[isaSpec[o].instType] += myOpcodes[o];
+    branches += opcodeUsage[o].isBranch ? myOpcodes[o] : 0;
+    jumps += opcodeUsage[o].isJump ? myOpcodes[o] : 0;
+  }
+  double branchFraction = count ? (double)branches / count : 0;
+  double jumpFraction = count ? (double)jumps / count : 0;
+
+  if (json) {
+    out << "{\"instructions\":" << count << ",\"inst_types\":{";
+    for (int t = 0; t < 3; t++)
+      out << (t ? "," : "") << "\"" << typeNames[t] << "\":" << types[t];
+    out << "},\"branches\":" << branches << ",\"jumps\":" << jumps
+        << ",\"branch_fraction\":" << branchFraction << ",\"jump_fraction\":" << jumpFraction
+        << ",\"opcodes\":{";
+    for (int o = 0; o < UNDEFINED; o++)
+      out << (o ? "," : "") << "\"" << isaSpec[o].name << "\":" << myOpcodes[o];
+    out << "},\"registers\":[";
+    for (int r = 0; r < NumRegisters; r++)
+      out << (r ? "," : "") << "{\"read\":" << myReads[r] << ",\"written\":" << myWrites[r] << "}";
+    out << "],\"immediates\":{";
+    bool first = true;
+    for (int k = OPERAND_SHAMT; k <= OPERAND_MEMORY; k++) {
+      const ImmediateRange& range = myImmediates[k];
+      out << (first ? "" : ",") << "\"" << immediateNames[k] << "\":{\"count\":" << range.count;
+      if (range.count > 0)
+        out << ",\"min\":" << range.min << ",\"max\":" << range.max
+            << ",\"negative\":" << range.negative << ",\"zero\":" << range.zero;
+      out << "}";
+      first = false;
+    }
+    out << "}}" << endl;
+    return;
+  }
+
+  out << "Instructions: " << count;
+  for (int t = 0; t < 3; t++)
+    out << (t ? ", " : " (") << typeNames[t] << " " << types[t];
+  out << ")" << endl << fixed << setprecision(2)
+      << "Branches: " << branches << " (" << 100 * branchFraction << "%), jumps: "
+      << jumps << " (" << 100 * jumpFraction << "%)" << endl;
+
+  // Opcodes that occur, most frequent first
+  vector<pair<uint64_t, int> > used;
+  for (int o = 0; o < UNDEFINED; o++)
+    if (myOpcodes[o] > 0)
+      used.push_back(make_pair(myOpcodes[o], o));
+  stable_sort(used.begin(), used.end(), [](const pair<uint64_t, int>& a, const pair<uint64_t, int>& b) {
+    return a.first > b.first;
+  });
+  out << "Opcodes:" << endl;
+  for (const pair<uint64_t, int>& entry : used)
+    out << "  " << left << setw(8) << isaSpec[entry.second].name << right << setw(14)
+        << entry.first << setw(9) << 100.0 * entry.first / count << "%" << endl;
+
+  out << "Registers:" << setw(12) << "read" << setw(14) << "written" << endl;
+  for (int r = 0; r < NumRegisters; r++)
+    if (myReads[r] > 0 || myWrites[r] > 0)
+      out << "  " << left << setw(8) << RegisterTable::getName(r) << right << setw(14)
+          << myReads[r] << setw(14) << myWrites[r] << endl;
+
+  out << "Immediates:" << setw(11) << "count" << setw(14) << "min" << setw(14) << "max"
+      << setw(14) << "negative" << setw(14) << "zero" << endl;
+  for (int k = OPERAND_SHAMT; k <= OPERAND_MEMORY; k++) {
+    const ImmediateRange& range = myImmediates[k];
+    if (range.count == 0)
+      continue;
+    out << "  " << left << setw(8) << immediateNames[k] << right << setw(14) << range.count
+        << setw(14) << range.min << setw(14) << range.max << setw(14) << range.negative
+        << setw(14) << range.zero << endl;
+  }
+  out << defaultfloat;
+}
@@ -0,0 +1,65 @@
+#ifndef __USAGEHISTOGRAM_H__
+#define __USAGEHISTOGRAM_H__
+
+#include "Instruction.h"
+#include "OpcodeTable.h"
+#include <iostream>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class gathers aggregate statistics over decoded Instructions
+ * straight from their fields: counts per Opcode and InstType, reads and
+ * writes of each register, the range of each kind of immediate operand,
+ * and the share of branches and jumps.  Nothing is formatted as text.
+ *
+ * Register reads and writes follow the instruction semantics: rs is read
+ * whenever it is used; rt is read by R-type instructions, branches and
+ * stores and written by the other I-type instructions; rd is written; and
+ * jal, bltzal and bgezal also write $31.  HI and LO are not counted.
+ *
+ * Histograms are merged by adding their counts, so separate threads or
+ * files can each fill one of their own.
+ */
+class UsageHistogram {
+
+ public:
+
+  // Creates an empty histogram
+  UsageHistogram();
+
+  // Counts one Instruction; UNDEFINED Instructions are ignored
+  void add(const Instruction& i);
+
+  // Counts count Instructions starting at instructions
+  void add(const Instruction *instructions, size_t count);
+
+  // Adds the counts of other to this histogram
+  void merge(const UsageHistogram& other);
+
+  // Returns the number of Instructions counted
+  uint64_t getCount() const;
+
+  // Prints the statistics, as a JSON object if json is true
+  void report(ostream& out, bool json) const;
+
+ private:
+
+  // The values seen for one kind of immediate operand
+  struct ImmediateRange {
+    uint64_t count;
+    uint64_t negative;
+    uint64_t zero;
+    int64_t min;
+    int64_t max;
+  };
+
+  uint64_t myOpcodes[UNDEFINED];
+  uint64_t myReads[NumRegisters];
+  uint64_t myWrites[NumRegisters];
+  ImmediateRange myImmediates[OPERAND_MEMORY + 1];  // indexed by OperandKind
+  OpcodeTable opcodes;
+
+};
+
+#endif
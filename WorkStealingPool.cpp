@@ -0,0 +1,123 @@
+#include "WorkStealingPool.h"
+
+// The pool and worker index of the current thread, if it is a worker
+static thread_local WorkStealingPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+// Starts numThreads worker threads (at least one)
+WorkStealingPool::WorkStealingPool(int numThreads) : myNextWorker(0), mySteals(0) {
+  myPushes = 0;
+  myPending = 0;
+  myStopping = false;
+
+  if (numThreads < 1)
+    numThreads = 1;
+
+  for (int i = 0; i < numThreads; i++)
+    myWorkers.push_back(unique_ptr<Worker>(new Worker()));
+  for (int i = 0; i < numThreads; i++)
+    myThreads.push_back(thread(&WorkStealingPool::workerLoop, this, i));
+}
+
+// Finishes the queued tasks and joins the worker threads
+WorkStealingPool::~WorkStealingPool() {
+  wait();
+  {
+    unique_lock<mutex> lock(myLock);
+    myStopping = true;
+  }
+  myTaskReady.notify_all();
+
+  for (int i = 0; i < (int)myThreads.size(); i++)
+    myThreads[i].join();
+}
+
+// Queues a task, on the calling worker's own deque if it is called from a
+// task of this pool
+void WorkStealingPool::submit(Task task) {
+  int target = currentWorker;
+  if (currentPool != this)
+    target = myNextWorker.fetch_add(1) % myWorkers.size();
+
+  // Pushed and counted under myLock, so a worker that saw myPushes before
+  // it searched the deques either found the task or sees the count change
+  {
+    unique_lock<mutex> lock(myLock);
+    unique_lock<mutex> own(myWorkers[target]->lock);
+    myWorkers[target]->tasks.push_back(move(task));
+    myPending++;
+    myPushes++;
+  }
+  myTaskReady.notify_one();
+}
+
+// Blocks until every submitted task, including those submitted by other
+// tasks, has finished
+void WorkStealingPool::wait() {
+  unique_lock<mutex> lock(myLock);
+  while (myPending > 0)
+    myAllDone.wait(lock);
+}
+
+// This function takes a task for worker self: its own newest, or else
+// the oldest of another worker.  Returns false if every deque is empty.
+bool WorkStealingPool::takeTask(int self, Task& task) {
+  {
+    Worker& own = *myWorkers[self];
+    unique_lock<mutex> lock(own.lock);
+    if (!own.tasks.empty()) {
+      task = move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  int numWorkers = (int)myWorkers.size();
+  for (int n = 1; n < numWorkers; n++) {
+    Worker& victim = *myWorkers[(self + n) % numWorkers];
+    unique_lock<mutex> lock(victim.lock);
+    if (!victim.tasks.empty()) {
+      task = move(victim.tasks.front());
+      victim.tasks.pop_front();
+      mySteals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Body of each worker thread: runs tasks until the pool stops
+void WorkStealingPool::workerLoop(int self) {
+  currentPool = this;
+  currentWorker = self;
+
+  // Value of myPushes before the last search of the deques
+  uint64_t pushes;
+  {
+    unique_lock<mutex> lock(myLock);
+    pushes = myPushes;
+  }
+
+  while (true) {
+    Task task;
+    if (!takeTask(self, task)) {
+      // Every task pushed before the search was found empty has been taken,
+      // so sleep until another is pushed
+      unique_lock<mutex> lock(myLock);
+      while (myPushes == pushes && !myStopping)
+        myTaskReady.wait(lock);
+      if (myPushes == pushes)
+        return;
+      pushes = myPushes;
+      continue;
+    }
+
+    task(self);
+
+    unique_lock<mutex> lock(myLock);
+    myPending--;
+    if (myPending == 0)
+      myAllDone.notify_all();
+    pushes = myPushes;
+  }
+}
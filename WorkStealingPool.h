@@ -0,0 +1,87 @@
+#ifndef __WORKSTEALINGPOOL_H__
+#define __WORKSTEALINGPOOL_H__
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+using namespace std;
+
+/* This class runs tasks on a fixed set of worker threads, each with a deque
+ * of its own.  A task submitted by a worker goes on that worker's deque,
+ * which it works through newest first, so a task that splits its work into
+ * subtasks keeps them close at hand.  A worker whose deque is empty steals
+ * the oldest task of another, so no thread idles while another has work
+ * queued behind a long task.  Tasks submitted from outside the pool are
+ * dealt out across the deques in turn.
+ *
+ * Each task is passed the index of the worker running it (0 to
+ * getNumThreads() - 1), for keeping per-worker state without locking.
+ */
+class WorkStealingPool {
+
+ public:
+
+  typedef function<void(int worker)> Task;
+
+  // Starts numThreads worker threads (at least one)
+  WorkStealingPool(int numThreads);
+
+  // Finishes the queued tasks and joins the worker threads
+  ~WorkStealingPool();
+
+  // Queues a task, on the calling worker's own deque if it is called from a
+  // task of this pool
+  void submit(Task task);
+
+  // Blocks until every submitted task, including those submitted by other
+  // tasks, has finished
+  void wait();
+
+  // Returns the number of worker threads
+  int getNumThreads()  { return (int)myThreads.size(); };
+
+  // Returns the number of tasks taken from another worker's deque
+  uint64_t getSteals() { return mySteals.load(); };
+
+ private:
+
+  // The deque of one worker.  The owner pushes and pops at the back;
+  // thieves take from the front.
+  struct Worker {
+    mutex lock;
+    deque<Task> tasks;
+  };
+
+  vector<unique_ptr<Worker> > myWorkers;
+  vector<thread> myThreads;
+  atomic<size_t> myNextWorker;      // deque for the next outside submission
+  atomic<uint64_t> mySteals;
+
+  mutex myLock;                     // guards the counters below
+  uint64_t myPushes;                // tasks pushed onto a deque so far
+  int myPending;                    // tasks submitted but not yet finished
+  bool myStopping;                  // set when the pool is being destroyed
+  condition_variable myTaskReady;   // signalled when a task is pushed or on shutdown
+  condition_variable myAllDone;     // signalled when myPending drops to 0
+
+  // This function takes a task for worker self: its own newest, or else
+  // the oldest of another worker.  Returns false if every deque is empty.
+  bool takeTask(int self, Task& task);
+
+  // Body of each worker thread: runs tasks until the pool stops
+  void workerLoop(int self);
+
+  // WorkStealingPools own threads, so they cannot be copied
+  WorkStealingPool(const WorkStealingPool&);
+  WorkStealingPool& operator=(const WorkStealingPool&);
+
+};
+
+#endif
@@ -0,0 +1,4 @@
+lw	$8, 4($9)
+sw	$10, 8($11)
+lb	$12, 0($13)
+sb	$14, 1($15)
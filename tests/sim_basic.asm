@@ -0,0 +1,33 @@
+addi	$8, $0, 5
+bltzal	$8, 4
+or	$9, $31, $0
+addi	$10, $0, -1
+bgezal	$10, 4
+or	$11, $31, $0
+bgezal	$8, 4
+addi	$20, $0, 99
+lui	$12, 0x1122
+ori	$12, $12, 0x3344
+sw	$12, 0($0)
+lui	$13, 0x5566
+ori	$13, $13, 0x7788
+sw	$13, 4($0)
+lwl	$14, 1($0)
+lwr	$14, 4($0)
+swl	$12, 9($0)
+swr	$12, 12($0)
+lw	$15, 8($0)
+lw	$16, 12($0)
+lui	$17, 0x8000
+addi	$18, $0, -1
+div	$17, $18
+mflo	$19
+addi	$21, $0, -7
+addi	$22, $0, 2
+div	$21, $22
+mflo	$23
+mfhi	$24
+divu	$21, $22
+mflo	$25
+div	$21, $0
+syscall
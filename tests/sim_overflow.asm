@@ -0,0 +1,5 @@
+lui	$8, 0x7fff
+ori	$8, $8, 0xffff
+addi	$9, $0, 1
+add	$10, $8, $9
+addi	$11, $0, 1